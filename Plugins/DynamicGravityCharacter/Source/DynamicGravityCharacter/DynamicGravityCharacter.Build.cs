@@ -26,6 +26,7 @@ public class DynamicGravityCharacter : ModuleRules
 			new string[]
 			{
 				"Core",
+				"PhysicsCore",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
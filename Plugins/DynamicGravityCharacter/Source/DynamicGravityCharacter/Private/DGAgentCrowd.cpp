@@ -0,0 +1,530 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGAgentCrowd.h"
+#include "DGCharacter.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGGravitySubsystem.h"
+#include "DGMath.h"
+#include "DGMovementSettings.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("DG Crowd Tick"), STAT_DGCrowdTick, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("DG Crowd ProbeFloors"), STAT_DGCrowdProbeFloors, STATGROUP_Character);
+
+
+ADGAgentCrowd::ADGAgentCrowd()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	Instances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Instances"));
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	RootComponent = Instances;
+
+	MovementSettings = NULL;
+	bSampleGravityFields = false;
+	MaxWalkSpeed = 300.f;
+	MaxAcceleration = 1024.f;
+	JumpZVelocity = 420.f;
+	CapsuleHalfHeight = 88.f;
+	WalkableFloorAngle = 44.765f;
+	ProbeDistance = 30.f;
+	ProbesPerFrame = 64;
+	ProbeValidDistance = 50.f;
+
+	PromotedCharacterClass = NULL;
+	PromotionDistance = 2000.f;
+	DemotionDistance = 2500.f;
+	MaxPromotionsPerFrame = 4;
+
+	ProbeCursor = 0;
+}
+
+int32 ADGAgentCrowd::AddAgent(FVector Location, FVector Forward)
+{
+	FDGCrowdAgent& Agent = Agents.AddDefaulted_GetRef();
+	Agent.Location = Location;
+	Agent.Forward = Forward.GetSafeNormal();
+	if (Agent.Forward.IsZero())
+	{
+		Agent.Forward = FVector::ForwardVector;
+	}
+
+	const FTransform Transform(FDGMath::MakeQuatFromZX(Agent.Up, Agent.Forward), Location);
+	Instances->AddInstanceWorldSpace(Transform);
+	InstanceTransforms.Add(Transform);
+	return Agents.Num() - 1;
+}
+
+void ADGAgentCrowd::SetAgentMoveInput(int32 AgentIndex, FVector MoveInput)
+{
+	if (Agents.IsValidIndex(AgentIndex))
+	{
+		Agents[AgentIndex].MoveInput = MoveInput.GetClampedToMaxSize(1.f);
+	}
+}
+
+bool ADGAgentCrowd::JumpAgent(int32 AgentIndex)
+{
+	if (!Agents.IsValidIndex(AgentIndex) || !Agents[AgentIndex].bOnGround || Agents[AgentIndex].IsPromoted())
+	{
+		return false;
+	}
+
+	// Same as UDGCharacterMovementComponent::DoJump.
+	FDGCrowdAgent& Agent = Agents[AgentIndex];
+	const FVector JumpNormal = GetAgentJumpDirection(Agent);
+	const float VerticalVelocity = FVector::DotProduct(Agent.Velocity, JumpNormal);
+	Agent.Velocity += -JumpNormal * FMath::Abs(VerticalVelocity) + JumpNormal * FMath::Max(VerticalVelocity, JumpZVelocity);
+	Agent.bOnGround = false;
+	Agent.bNeedsProbe = true;
+	return true;
+}
+
+FVector ADGAgentCrowd::GetAgentGravity(const FDGCrowdAgent& Agent) const
+{
+	const FVector WorldGravity = GetWorld()->GetGravityZ() * UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+	const bool bIgnoreWorldGravity = MovementSettings != NULL && MovementSettings->bIgnoreWorldGravityIfDynamicGravityIsNotZero;
+	const FVector Dynamic = Agent.GetDynamicGravity();
+	return (bIgnoreWorldGravity && !Dynamic.Equals(FVector::ZeroVector)) ? Dynamic : WorldGravity + Dynamic;
+}
+
+FVector ADGAgentCrowd::GetAgentWalkableFloorNormal(const FDGCrowdAgent& Agent) const
+{
+	const EWalkableFloorNormalMode Mode = MovementSettings != NULL ? MovementSettings->WalkableFloorNormalMode : UDGCharacterMovementComponent::DEFAULT_WALKABLE_FLOOR_NORMAL_MODE;
+	const FVector WorldGravityNormal = GetWorld()->GetGravityZ() >= 0 ? UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION : -UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+
+	switch (Mode)
+	{
+	case EWalkableFloorNormalMode::WFN_Gravity:
+		return -GetAgentGravity(Agent).GetSafeNormal();
+	case EWalkableFloorNormalMode::WFN_DynamicGravity:
+		return -Agent.GetDynamicGravity().GetSafeNormal();
+	case EWalkableFloorNormalMode::WFN_WorldGravity:
+		return -WorldGravityNormal;
+	case EWalkableFloorNormalMode::WFN_CharacterRotation:
+		return Agent.Up;
+	case EWalkableFloorNormalMode::WFN_FloorImpactNormal:
+		return Agent.bOnGround ? Agent.FloorNormal : FVector::ZeroVector;
+	case EWalkableFloorNormalMode::WFN_NoFloor:
+		return FVector::ZeroVector;
+	default:
+		return MovementSettings != NULL ? MovementSettings->CustomWalkableFloorNormal : UDGCharacterMovementComponent::DEFAULT_CUSTOM_WALKABLE_FLOOR_NORMAL;
+	}
+}
+
+FVector ADGAgentCrowd::GetAgentJumpDirection(const FDGCrowdAgent& Agent) const
+{
+	const EJumpDirectionMode Mode = MovementSettings != NULL ? MovementSettings->JumpDirectionMode : UDGCharacterMovementComponent::DEFAULT_JUMP_DIRECTION_MODE;
+	const FVector WorldGravityNormal = GetWorld()->GetGravityZ() >= 0 ? UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION : -UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+
+	switch (Mode)
+	{
+	case EJumpDirectionMode::JDM_Gravity:
+		return -GetAgentGravity(Agent).GetSafeNormal();
+	case EJumpDirectionMode::JDM_DynamicGravity:
+		return -Agent.GetDynamicGravity().GetSafeNormal();
+	case EJumpDirectionMode::JDM_WorldGravity:
+		return -WorldGravityNormal;
+	case EJumpDirectionMode::JDM_VerticalDirection:
+		return Agent.Up;
+	default:
+		return MovementSettings != NULL ? MovementSettings->CustomJumpDirection : UDGCharacterMovementComponent::DEFAULT_CUSTOM_JUMP_DIRECTION;
+	}
+}
+
+FVector ADGAgentCrowd::GetAgentRotationVerticalDirection(const FDGCrowdAgent& Agent) const
+{
+	const EPhysicsRotationVerticalDirectionMode Mode = MovementSettings != NULL ? MovementSettings->PhysicsRotationVerticalDirectionMode : UDGCharacterMovementComponent::DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE;
+	const FVector WorldGravityNormal = GetWorld()->GetGravityZ() >= 0 ? UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION : -UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+
+	switch (Mode)
+	{
+	case EPhysicsRotationVerticalDirectionMode::PRVDM_Gravity:
+		return -GetAgentGravity(Agent).GetSafeNormal();
+	case EPhysicsRotationVerticalDirectionMode::PRVDM_WorldGravity:
+		return -WorldGravityNormal;
+	case EPhysicsRotationVerticalDirectionMode::PRVDM_DynamicGravity:
+		return -Agent.GetDynamicGravity().GetSafeNormal();
+	case EPhysicsRotationVerticalDirectionMode::PRVDM_VerticalDirection:
+		return Agent.FloorNormal;
+	default:
+		return FRotationMatrix(MovementSettings != NULL ? MovementSettings->CustomPhysicsRotationVerticalDirection : UDGCharacterMovementComponent::DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION).GetScaledAxis(EAxis::Z);
+	}
+}
+
+void ADGAgentCrowd::SampleAgentGravity()
+{
+	UDGGravitySubsystem* GravitySubsystem = bSampleGravityFields ? GetWorld()->GetSubsystem<UDGGravitySubsystem>() : NULL;
+	if (GravitySubsystem == NULL)
+	{
+		// Clear what was sampled before the fields were turned off.
+		for (FDGCrowdAgent& Agent : Agents)
+		{
+			Agent.FieldGravity = FVector::ZeroVector;
+		}
+		return;
+	}
+
+	AgentLocations.SetNumUninitialized(Agents.Num());
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		AgentLocations[Index] = Agents[Index].Location;
+	}
+
+	GravitySubsystem->SampleGravityBatch(AgentLocations, AgentGravity);
+
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		Agents[Index].FieldGravity = AgentGravity[Index];
+	}
+}
+
+void ADGAgentCrowd::MoveAgents(float DeltaSeconds)
+{
+	const float WalkableFloorZ = FMath::Cos(FMath::DegreesToRadians(WalkableFloorAngle));
+	const EWalkableFloorNormalMode WalkableFloorNormalMode = MovementSettings != NULL ? MovementSettings->WalkableFloorNormalMode : UDGCharacterMovementComponent::DEFAULT_WALKABLE_FLOOR_NORMAL_MODE;
+	const float RotationAdjustIntensity = MovementSettings != NULL ? MovementSettings->RotationAdjustIntensity : UDGCharacterMovementComponent::DEFAULT_LERP_ROTATION_RATE;
+	const float RotationAlpha = RotationAdjustIntensity < 0.f ? 1.f : FMath::Min(RotationAdjustIntensity * DeltaSeconds, 1.f);
+
+	for (FDGCrowdAgent& Agent : Agents)
+	{
+		if (Agent.IsPromoted())
+		{
+			if (!Agent.MoveInput.IsZero())
+			{
+				Agent.PromotedCharacter->AddMovementInput(Agent.MoveInput);
+			}
+			continue;
+		}
+
+		const FVector Gravity = GetAgentGravity(Agent);
+
+		if (Agent.bOnGround && WalkableFloorNormalMode == EWalkableFloorNormalMode::WFN_CharacterRotation)
+		{
+			// The walkable floor normal is the rotation of the agent, which turns like UDGCharacterMovementComponent::PhysicsRotation.
+			const FVector RotationUp = GetAgentRotationVerticalDirection(Agent);
+			if (RotationUp.IsNormalized())
+			{
+				Agent.Up = FQuat::Slerp(FQuat::Identity, FQuat::FindBetweenNormals(Agent.Up, RotationUp), RotationAlpha).RotateVector(Agent.Up).GetSafeNormal();
+			}
+		}
+
+		// Same order of UDGCharacterMovementComponent::UpdateVerticalDirection.
+		FVector NewUp = Agent.bOnGround ? GetAgentWalkableFloorNormal(Agent) : FVector::ZeroVector;
+		if (!NewUp.IsNormalized())
+		{
+			NewUp = -Gravity.GetSafeNormal();
+		}
+		if (!NewUp.IsNormalized())
+		{
+			NewUp = FVector::UpVector;
+		}
+		Agent.Up = NewUp;
+
+		if (Agent.bOnGround)
+		{
+			// Tangent velocity approaching the requested one with limited acceleration.
+			const FVector DesiredVelocity = FDGMath::HorizontalComponent(Agent.MoveInput, Agent.Up) * MaxWalkSpeed;
+			const FVector CurrentVelocity = FDGMath::HorizontalComponent(Agent.Velocity, Agent.Up);
+			const FVector VelocityChange = (DesiredVelocity - CurrentVelocity).GetClampedToMaxSize(MaxAcceleration * DeltaSeconds);
+			Agent.Velocity = CurrentVelocity + VelocityChange;
+
+			// Project the feet on the floor plane along the vertical direction.
+			FVector NewLocation = Agent.Location + Agent.Velocity * DeltaSeconds;
+			const float NormalDotUp = Agent.FloorNormal | Agent.Up;
+			if (NormalDotUp >= WalkableFloorZ)
+			{
+				const FVector Feet = NewLocation - Agent.Up * CapsuleHalfHeight;
+				NewLocation -= Agent.Up * (((Feet - Agent.FloorPoint) | Agent.FloorNormal) / NormalDotUp);
+			}
+			else
+			{
+				Agent.bOnGround = false;
+			}
+
+			Agent.Location = NewLocation;
+
+			if (FDGMath::HorizontalComponent(Agent.Location - Agent.FloorPoint, Agent.Up).SizeSquared() > FMath::Square(ProbeValidDistance))
+			{
+				Agent.bNeedsProbe = true;
+			}
+		}
+
+		if (!Agent.bOnGround)
+		{
+			// Exact for a constant gravity during the frame.
+			Agent.Location += Agent.Velocity * DeltaSeconds + Gravity * (0.5f * FMath::Square(DeltaSeconds));
+			Agent.Velocity += Gravity * DeltaSeconds;
+			Agent.bNeedsProbe = true;
+		}
+
+		const FVector Forward = FDGMath::HorizontalDirection(Agent.Velocity.SizeSquared() > 1.f ? Agent.Velocity : Agent.Forward, Agent.Up);
+		if (!Forward.IsZero())
+		{
+			Agent.Forward = Forward;
+		}
+	}
+}
+
+void ADGAgentCrowd::ProbeFloors()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DGCrowdProbeFloors);
+
+	UWorld* World = GetWorld();
+	const float WalkableFloorZ = FMath::Cos(FMath::DegreesToRadians(WalkableFloorAngle));
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(DGCrowdFloor), false, this);
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+
+	auto Probe = [&](FDGCrowdAgent& Agent)
+	{
+		Agent.bNeedsProbe = false;
+
+		const FVector WalkableNormal = GetAgentWalkableFloorNormal(Agent);
+		if (!WalkableNormal.IsNormalized())
+		{
+			Agent.bOnGround = false;
+			return;
+		}
+
+		// Falling agents look ahead by the distance of the next frame, so they don't pass through the floor.
+		const float LookAhead = Agent.bOnGround ? 0.f : FMath::Max(0.f, -(Agent.Velocity | WalkableNormal) * World->GetDeltaSeconds());
+		const FVector Start = Agent.Location;
+		const FVector End = Start - WalkableNormal * (CapsuleHalfHeight + ProbeDistance + LookAhead);
+
+		FHitResult Hit;
+		if (!World->LineTraceSingleByObjectType(Hit, Start, End, ObjectQueryParams, QueryParams) || (Hit.ImpactNormal | WalkableNormal) < WalkableFloorZ)
+		{
+			Agent.bOnGround = false;
+			return;
+		}
+
+		Agent.FloorPoint = Hit.ImpactPoint;
+		Agent.FloorNormal = Hit.ImpactNormal;
+
+		if (!Agent.bOnGround)
+		{
+			// Land only when moving to the floor.
+			if ((Agent.Velocity | WalkableNormal) > 0.f)
+			{
+				return;
+			}
+
+			Agent.bOnGround = true;
+			Agent.Location = Hit.ImpactPoint + WalkableNormal * CapsuleHalfHeight;
+			Agent.Velocity = FDGMath::HorizontalComponent(Agent.Velocity, WalkableNormal);
+		}
+	};
+
+	// Agents that must be probed, then a round robin over the rest.
+	for (FDGCrowdAgent& Agent : Agents)
+	{
+		if (Agent.bNeedsProbe && !Agent.IsPromoted())
+		{
+			Probe(Agent);
+		}
+	}
+
+	const int32 NumProbes = FMath::Min(ProbesPerFrame, Agents.Num());
+	for (int32 Count = 0; Count < NumProbes; ++Count)
+	{
+		ProbeCursor = (ProbeCursor + 1) % Agents.Num();
+		if (!Agents[ProbeCursor].IsPromoted())
+		{
+			Probe(Agents[ProbeCursor]);
+		}
+	}
+}
+
+ADGCharacter* ADGAgentCrowd::PromoteAgent(int32 AgentIndex)
+{
+	if (!Agents.IsValidIndex(AgentIndex) || Agents[AgentIndex].IsPromoted() || PromotedCharacterClass == NULL)
+	{
+		return NULL;
+	}
+
+	FDGCrowdAgent& Agent = Agents[AgentIndex];
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	const FRotator Rotation = FDGMath::MakeQuatFromZX(Agent.Up, Agent.Forward).Rotator();
+	ADGCharacter* Character = GetWorld()->SpawnActor<ADGCharacter>(PromotedCharacterClass, Agent.Location, Rotation, SpawnParameters);
+	if (Character == NULL)
+	{
+		return NULL;
+	}
+
+	// Characters spawned at runtime are only possessed on spawn with AutoPossessAI PlacedInWorldOrSpawned or Spawned; without a controller they wouldn't move.
+	if (Character->GetController() == NULL)
+	{
+		Character->SpawnDefaultController();
+	}
+
+	if (UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(Character->GetCharacterMovement()))
+	{
+		if (MovementSettings != NULL && MovementComponent->MovementSettings == NULL)
+		{
+			MovementComponent->SetMovementSettings(MovementSettings);
+		}
+		MovementComponent->bSampleGravityFields = bSampleGravityFields;
+		MovementComponent->DynamicGravity = Agent.DynamicGravity;
+		MovementComponent->FieldGravity = Agent.FieldGravity;
+		MovementComponent->Velocity = Agent.Velocity;
+		MovementComponent->SetMovementMode(Agent.bOnGround ? MOVE_Walking : MOVE_Falling);
+	}
+
+	Agent.PromotedCharacter = Character;
+
+	// Keep walking where the agent was going. MoveAgents forwards the input in the next frames.
+	if (!Agent.MoveInput.IsZero())
+	{
+		Character->AddMovementInput(Agent.MoveInput);
+	}
+
+	// Hide the instance while the character is alive.
+	const FTransform HiddenTransform(FQuat::Identity, Agent.Location, FVector::ZeroVector);
+	Instances->UpdateInstanceTransform(AgentIndex, HiddenTransform, true, true, true);
+	if (InstanceTransforms.IsValidIndex(AgentIndex))
+	{
+		InstanceTransforms[AgentIndex] = HiddenTransform;
+	}
+	return Character;
+}
+
+void ADGAgentCrowd::DemoteAgent(int32 AgentIndex)
+{
+	if (!Agents.IsValidIndex(AgentIndex) || !Agents[AgentIndex].IsPromoted())
+	{
+		return;
+	}
+
+	FDGCrowdAgent& Agent = Agents[AgentIndex];
+	ADGCharacter* Character = Agent.PromotedCharacter.Get();
+
+	Agent.Location = Character->GetActorLocation();
+	Agent.Velocity = Character->GetVelocity();
+	Agent.Forward = Character->GetActorForwardVector();
+	if (const UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(Character->GetCharacterMovement()))
+	{
+		Agent.Up = MovementComponent->VerticalDirection;
+		Agent.DynamicGravity = MovementComponent->DynamicGravity;
+		Agent.FieldGravity = MovementComponent->FieldGravity;
+		Agent.bOnGround = MovementComponent->IsMovingOnGround();
+	}
+	Agent.bNeedsProbe = true;
+	Agent.PromotedCharacter.Reset();
+
+	Character->Destroy();
+}
+
+void ADGAgentCrowd::UpdatePromotion()
+{
+	if (PromotedCharacterClass == NULL)
+	{
+		return;
+	}
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APawn* PlayerPawn = PlayerController != NULL ? PlayerController->GetPawn() : NULL;
+	if (PlayerPawn == NULL)
+	{
+		return;
+	}
+
+	const FVector PlayerLocation = PlayerPawn->GetActorLocation();
+	const float PromotionDistSquared = FMath::Square(PromotionDistance);
+	const float DemotionDistSquared = FMath::Square(FMath::Max(DemotionDistance, PromotionDistance));
+	int32 NumPromotions = 0;
+
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		FDGCrowdAgent& Agent = Agents[Index];
+		if (Agent.IsPromoted())
+		{
+			if (FVector::DistSquared(Agent.PromotedCharacter->GetActorLocation(), PlayerLocation) > DemotionDistSquared)
+			{
+				DemoteAgent(Index);
+			}
+		}
+		else if (NumPromotions < MaxPromotionsPerFrame && FVector::DistSquared(Agent.Location, PlayerLocation) < PromotionDistSquared)
+		{
+			if (PromoteAgent(Index) != NULL)
+			{
+				++NumPromotions;
+			}
+		}
+	}
+}
+
+void ADGAgentCrowd::UpdateInstances()
+{
+	// Agents without a written transform are always sent.
+	const int32 NumWritten = FMath::Min(InstanceTransforms.Num(), Agents.Num());
+	InstanceTransforms.SetNum(Agents.Num(), false);
+
+	bool bAnyMoved = false;
+	int32 RangeStart = INDEX_NONE;
+	MovedInstanceTransforms.Reset();
+	for (int32 Index = 0; Index <= Agents.Num(); ++Index)
+	{
+		bool bMoved = false;
+		if (Index < Agents.Num())
+		{
+			const FDGCrowdAgent& Agent = Agents[Index];
+			const FTransform Transform = Agent.IsPromoted()
+				? FTransform(FQuat::Identity, Agent.Location, FVector::ZeroVector)
+				: FTransform(FDGMath::MakeQuatFromZX(Agent.Up, Agent.Forward), Agent.Location);
+
+			bMoved = Index >= NumWritten || !Transform.Equals(InstanceTransforms[Index]);
+			if (bMoved)
+			{
+				InstanceTransforms[Index] = Transform;
+				MovedInstanceTransforms.Add(Transform);
+				if (RangeStart == INDEX_NONE)
+				{
+					RangeStart = Index;
+				}
+			}
+		}
+
+		// Each contiguous range of moved agents is one batch.
+		if (!bMoved && RangeStart != INDEX_NONE)
+		{
+			Instances->BatchUpdateInstancesTransforms(RangeStart, MovedInstanceTransforms, true, false, true);
+			MovedInstanceTransforms.Reset();
+			RangeStart = INDEX_NONE;
+			bAnyMoved = true;
+		}
+	}
+
+	if (bAnyMoved)
+	{
+		Instances->MarkRenderStateDirty();
+	}
+}
+
+void ADGAgentCrowd::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DGCrowdTick);
+
+	Super::Tick(DeltaSeconds);
+
+	if (Agents.Num() == 0)
+	{
+		return;
+	}
+
+	SampleAgentGravity();
+	MoveAgents(DeltaSeconds);
+	ProbeFloors();
+	UpdatePromotion();
+	UpdateInstances();
+}
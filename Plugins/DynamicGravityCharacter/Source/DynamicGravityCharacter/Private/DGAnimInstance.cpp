@@ -0,0 +1,115 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGAnimInstance.h"
+#include "DGCharacter.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGMath.h"
+
+
+FDGAnimInstanceProxy::FDGAnimInstanceProxy(UAnimInstance* InAnimInstance)
+	: FAnimInstanceProxy(InAnimInstance)
+	, DGAnimInstance(Cast<UDGAnimInstance>(InAnimInstance))
+	, Velocity(ForceInitToZero)
+	, Acceleration(ForceInitToZero)
+	, VerticalDirection(FVector::UpVector)
+	, SurfaceNormal(FVector::UpVector)
+	, ActorQuat(FQuat::Identity)
+	, MovementMode(MOVE_None)
+	, bIsMovingOnGround(false)
+	, bIsCrouching(false)
+{
+}
+
+void FDGAnimInstanceProxy::Initialize(UAnimInstance* InAnimInstance)
+{
+	FAnimInstanceProxy::Initialize(InAnimInstance);
+
+	DGAnimInstance = Cast<UDGAnimInstance>(InAnimInstance);
+}
+
+void FDGAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+#if !UE_SERVER
+	const UDGCharacterMovementComponent* Movement = DGAnimInstance != NULL ? DGAnimInstance->DGMovement.Get() : NULL;
+	if (Movement == NULL || Movement->GetCharacterOwner() == NULL)
+	{
+		MovementMode = MOVE_None;
+		return;
+	}
+
+	// The kinematics of the last movement tick, refreshed once per tick by the movement component.
+	const FDGKinematicsSnapshot& Kinematics = Movement->GetKinematics();
+	Velocity = Kinematics.Velocity;
+	VerticalDirection = Kinematics.VerticalDirection;
+	SurfaceNormal = Kinematics.FloorNormal;
+	MovementMode = Kinematics.MovementMode;
+	bIsMovingOnGround = Kinematics.bIsMovingOnGround;
+	Acceleration = Movement->GetCurrentAcceleration();
+	ActorQuat = Movement->GetCharacterOwner()->GetActorQuat();
+	bIsCrouching = Movement->IsCrouching();
+#endif
+}
+
+void FDGAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+#if !UE_SERVER
+	if (DGAnimInstance == NULL)
+	{
+		return;
+	}
+
+	FDGLocomotionSnapshot& Locomotion = DGAnimInstance->Locomotion;
+	Locomotion.Velocity = Velocity;
+	Locomotion.VerticalDirection = VerticalDirection;
+	Locomotion.SurfaceNormal = SurfaceNormal;
+	Locomotion.MovementMode = MovementMode;
+	Locomotion.bIsFalling = MovementMode == MOVE_Falling;
+	Locomotion.bIsMovingOnGround = bIsMovingOnGround;
+	Locomotion.bIsCrouching = bIsCrouching;
+
+	FDGMath::Decompose(Velocity, VerticalDirection, Locomotion.VerticalVelocity, Locomotion.HorizontalVelocity);
+	Locomotion.Speed = Velocity.Size();
+	Locomotion.HorizontalSpeed = Locomotion.HorizontalVelocity.Size();
+	Locomotion.SignedVerticalSpeed = Velocity | VerticalDirection;
+
+	Locomotion.HorizontalAcceleration = FDGMath::HorizontalComponent(Acceleration, VerticalDirection);
+	Locomotion.bIsAccelerating = !Locomotion.HorizontalAcceleration.IsNearlyZero();
+
+	// Angle of the horizontal velocity around the vertical direction, from the forward of the character.
+	const FVector Forward = FDGMath::HorizontalDirection(ActorQuat.GetForwardVector(), VerticalDirection);
+	if (Locomotion.HorizontalSpeed > KINDA_SMALL_NUMBER && !Forward.IsZero())
+	{
+		const FVector Right = VerticalDirection ^ Forward;
+		Locomotion.Direction = FMath::RadiansToDegrees(FMath::Atan2(Locomotion.HorizontalVelocity | Right, Locomotion.HorizontalVelocity | Forward));
+	}
+	else
+	{
+		Locomotion.Direction = 0.f;
+	}
+
+	DGAnimInstance->NativeThreadSafeUpdateLocomotion(DeltaSeconds);
+#endif
+}
+
+
+UDGAnimInstance::UDGAnimInstance()
+{
+}
+
+void UDGAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	DGCharacter = Cast<ADGCharacter>(TryGetPawnOwner());
+	DGMovement = DGCharacter.IsValid() ? Cast<UDGCharacterMovementComponent>(DGCharacter->GetCharacterMovement()) : NULL;
+}
+
+FAnimInstanceProxy* UDGAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FDGAnimInstanceProxy(this);
+}
@@ -0,0 +1,378 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGAvoidanceSubsystem.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGMath.h"
+
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("DG Avoidance"), STAT_DGAvoidance, STATGROUP_Character);
+
+
+namespace DGAvoidance
+{
+	const float ORCA_EPSILON = 0.00001f;
+
+	/** Half plane of allowed velocities: the velocities on the left of the directed line. */
+	struct FLine
+	{
+		FVector2D Point;
+		FVector2D Direction;
+	};
+
+	/** Lines of one agent, inline up to the neighbours gathered without a heap allocation. */
+	typedef TArray<FLine, TInlineAllocator<16>> FLineArray;
+
+	FORCEINLINE float Det(const FVector2D& A, const FVector2D& B)
+	{
+		return A.X * B.Y - A.Y * B.X;
+	}
+
+	/** Optimizes on the line LineIndex, constrained by the lines before it. */
+	bool LinearProgram1(const FLineArray& Lines, int32 LineIndex, float Radius, const FVector2D& OptVelocity, bool bDirectionOpt, FVector2D& Result)
+	{
+		const FLine& Line = Lines[LineIndex];
+		const float DotProduct = Line.Point | Line.Direction;
+		const float Discriminant = FMath::Square(DotProduct) + FMath::Square(Radius) - Line.Point.SizeSquared();
+
+		if (Discriminant < 0.f)
+		{
+			// The max speed circle fully invalidates the line.
+			return false;
+		}
+
+		const float SqrtDiscriminant = FMath::Sqrt(Discriminant);
+		float TLeft = -DotProduct - SqrtDiscriminant;
+		float TRight = -DotProduct + SqrtDiscriminant;
+
+		for (int32 Index = 0; Index < LineIndex; ++Index)
+		{
+			const float Denominator = Det(Line.Direction, Lines[Index].Direction);
+			const float Numerator = Det(Lines[Index].Direction, Line.Point - Lines[Index].Point);
+
+			if (FMath::Abs(Denominator) <= ORCA_EPSILON)
+			{
+				// The lines are almost parallel.
+				if (Numerator < 0.f)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			const float T = Numerator / Denominator;
+			if (Denominator >= 0.f)
+			{
+				TRight = FMath::Min(TRight, T);
+			}
+			else
+			{
+				TLeft = FMath::Max(TLeft, T);
+			}
+
+			if (TLeft > TRight)
+			{
+				return false;
+			}
+		}
+
+		if (bDirectionOpt)
+		{
+			Result = Line.Point + ((OptVelocity | Line.Direction) > 0.f ? TRight : TLeft) * Line.Direction;
+		}
+		else
+		{
+			const float T = Line.Direction | (OptVelocity - Line.Point);
+			Result = Line.Point + FMath::Clamp(T, TLeft, TRight) * Line.Direction;
+		}
+
+		return true;
+	}
+
+	/** Optimizes within all the lines. Returns the number of lines on success, or the index of the line where it failed. */
+	int32 LinearProgram2(const FLineArray& Lines, float Radius, const FVector2D& OptVelocity, bool bDirectionOpt, FVector2D& Result)
+	{
+		if (bDirectionOpt)
+		{
+			Result = OptVelocity * Radius;
+		}
+		else if (OptVelocity.SizeSquared() > FMath::Square(Radius))
+		{
+			Result = OptVelocity.GetSafeNormal() * Radius;
+		}
+		else
+		{
+			Result = OptVelocity;
+		}
+
+		for (int32 Index = 0; Index < Lines.Num(); ++Index)
+		{
+			if (Det(Lines[Index].Direction, Lines[Index].Point - Result) > 0.f)
+			{
+				// The result doesn't satisfy the constraint of this line.
+				const FVector2D TempResult = Result;
+				if (!LinearProgram1(Lines, Index, Radius, OptVelocity, bDirectionOpt, Result))
+				{
+					Result = TempResult;
+					return Index;
+				}
+			}
+		}
+
+		return Lines.Num();
+	}
+
+	/** When the program is infeasible, finds the velocity that least violates the lines from BeginLine on. */
+	void LinearProgram3(const FLineArray& Lines, int32 BeginLine, float Radius, FVector2D& Result)
+	{
+		float Distance = 0.f;
+		FLineArray ProjectedLines;
+
+		for (int32 Index = BeginLine; Index < Lines.Num(); ++Index)
+		{
+			if (Det(Lines[Index].Direction, Lines[Index].Point - Result) <= Distance)
+			{
+				continue;
+			}
+
+			ProjectedLines.Reset();
+			for (int32 Other = 0; Other < Index; ++Other)
+			{
+				FLine Line;
+				const float Determinant = Det(Lines[Index].Direction, Lines[Other].Direction);
+
+				if (FMath::Abs(Determinant) <= ORCA_EPSILON)
+				{
+					if ((Lines[Index].Direction | Lines[Other].Direction) > 0.f)
+					{
+						// Same direction.
+						continue;
+					}
+					Line.Point = 0.5f * (Lines[Index].Point + Lines[Other].Point);
+				}
+				else
+				{
+					Line.Point = Lines[Index].Point + (Det(Lines[Other].Direction, Lines[Index].Point - Lines[Other].Point) / Determinant) * Lines[Index].Direction;
+				}
+
+				Line.Direction = (Lines[Other].Direction - Lines[Index].Direction).GetSafeNormal();
+				ProjectedLines.Add(Line);
+			}
+
+			const FVector2D TempResult = Result;
+			if (LinearProgram2(ProjectedLines, Radius, FVector2D(-Lines[Index].Direction.Y, Lines[Index].Direction.X), true, Result) < ProjectedLines.Num())
+			{
+				// Should not happen, the result is already in the feasible region of this program. Only a floating point error.
+				Result = TempResult;
+			}
+
+			Distance = Det(Lines[Index].Direction, Lines[Index].Point - Result);
+		}
+	}
+}
+
+
+UDGAvoidanceSubsystem::UDGAvoidanceSubsystem()
+{
+	CellSize = 500.f;
+	SpatialHashFrame = 0;
+}
+
+void UDGAvoidanceSubsystem::RegisterAgent(UDGCharacterMovementComponent* Agent)
+{
+	Agents.AddUnique(Agent);
+	SpatialHashFrame = 0;
+}
+
+void UDGAvoidanceSubsystem::UnregisterAgent(UDGCharacterMovementComponent* Agent)
+{
+	Agents.RemoveSwap(Agent);
+	SpatialHashFrame = 0;
+}
+
+FIntVector UDGAvoidanceSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UDGAvoidanceSubsystem::UpdateSpatialHash()
+{
+	if (SpatialHashFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	SpatialHashFrame = GFrameCounter;
+	AgentStates.Reset();
+	SpatialHash.Reset();
+
+	for (int32 Index = Agents.Num() - 1; Index >= 0; --Index)
+	{
+		const UDGCharacterMovementComponent* Agent = Agents[Index].Get();
+		if (Agent == NULL)
+		{
+			Agents.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		if (Agent->UpdatedComponent == NULL || Agent->GetCharacterOwner() == NULL)
+		{
+			continue;
+		}
+
+		FAgentState& State = AgentStates.AddDefaulted_GetRef();
+		State.Location = Agent->UpdatedComponent->GetComponentLocation();
+		State.Velocity = Agent->Velocity;
+		State.Up = Agent->VerticalDirection;
+		State.Radius = Agent->GetCharacterOwner()->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		State.Component = Agent;
+
+		SpatialHash.Add(GetCell(State.Location), AgentStates.Num() - 1);
+	}
+}
+
+FVector UDGAvoidanceSubsystem::ComputeAvoidanceVelocity(const UDGCharacterMovementComponent* Agent, const FVector& PreferredVelocity, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DGAvoidance);
+
+	if (Agent == NULL || Agent->UpdatedComponent == NULL || Agent->GetCharacterOwner() == NULL || DeltaTime <= 0.f)
+	{
+		return PreferredVelocity;
+	}
+
+	UpdateSpatialHash();
+
+	const FVector Location = Agent->UpdatedComponent->GetComponentLocation();
+	const FVector Up = Agent->VerticalDirection;
+	const float Radius = Agent->GetCharacterOwner()->GetCapsuleComponent()->GetScaledCapsuleRadius();
+	const float ConsiderationRadius = Agent->AvoidanceConsiderationRadius;
+
+	// Tangent plane basis.
+	FVector AxisX, AxisY, AxisZ;
+	FDGMath::MakeBasisFromZX(Up, Agent->UpdatedComponent->GetForwardVector(), AxisX, AxisY, AxisZ);
+	auto ToPlane = [&AxisX, &AxisY](const FVector& Vector) { return FVector2D(Vector | AxisX, Vector | AxisY); };
+
+	// Nearest neighbors on the same side of the surface.
+	struct FNeighbor
+	{
+		int32 State;
+		float DistSquared;
+	};
+	TArray<FNeighbor, TInlineAllocator<16>> Neighbors;
+
+	const int32 CellRange = FMath::Max(1, FMath::CeilToInt(ConsiderationRadius / CellSize));
+	const FIntVector Cell = GetCell(Location);
+	for (int32 X = -CellRange; X <= CellRange; ++X)
+	{
+		for (int32 Y = -CellRange; Y <= CellRange; ++Y)
+		{
+			for (int32 Z = -CellRange; Z <= CellRange; ++Z)
+			{
+				for (auto It = SpatialHash.CreateConstKeyIterator(Cell + FIntVector(X, Y, Z)); It; ++It)
+				{
+					const FAgentState& State = AgentStates[It.Value()];
+					if (State.Component == Agent || (State.Up | Up) < 0.5f)
+					{
+						continue;
+					}
+
+					const float DistSquared = FVector::DistSquared(State.Location, Location);
+					if (DistSquared <= FMath::Square(ConsiderationRadius))
+					{
+						Neighbors.Add({ It.Value(), DistSquared });
+					}
+				}
+			}
+		}
+	}
+
+	if (Neighbors.Num() == 0)
+	{
+		return PreferredVelocity;
+	}
+
+	Neighbors.Sort([](const FNeighbor& A, const FNeighbor& B) { return A.DistSquared < B.DistSquared; });
+	if (Neighbors.Num() > Agent->MaxAvoidanceNeighbors)
+	{
+		Neighbors.SetNum(FMath::Max(0, Agent->MaxAvoidanceNeighbors), false);
+	}
+
+	const FVector2D Velocity = ToPlane(Agent->Velocity);
+	const FVector2D OptVelocity = ToPlane(PreferredVelocity);
+	const float MaxSpeed = FMath::Max(Agent->GetMaxSpeed(), OptVelocity.Size());
+	const float InvTimeHorizon = 1.f / FMath::Max(Agent->AvoidanceTimeHorizon, KINDA_SMALL_NUMBER);
+	const float InvTimeStep = 1.f / DeltaTime;
+
+	// ORCA lines, half of the avoidance is taken by each agent.
+	DGAvoidance::FLineArray Lines;
+	Lines.Reserve(Neighbors.Num());
+	for (const FNeighbor& Neighbor : Neighbors)
+	{
+		const FAgentState& Other = AgentStates[Neighbor.State];
+		const FVector2D RelativePosition = ToPlane(Other.Location - Location);
+		const FVector2D RelativeVelocity = Velocity - ToPlane(Other.Velocity);
+		const float DistSquared = RelativePosition.SizeSquared();
+		const float CombinedRadius = Radius + Other.Radius;
+		const float CombinedRadiusSquared = FMath::Square(CombinedRadius);
+
+		DGAvoidance::FLine Line;
+		FVector2D U;
+
+		if (DistSquared > CombinedRadiusSquared)
+		{
+			// No collision. Vector from the cutoff center to the relative velocity.
+			const FVector2D W = RelativeVelocity - InvTimeHorizon * RelativePosition;
+			const float WLengthSquared = W.SizeSquared();
+			const float DotProduct1 = W | RelativePosition;
+
+			if (DotProduct1 < 0.f && FMath::Square(DotProduct1) > CombinedRadiusSquared * WLengthSquared)
+			{
+				// Project on the cutoff circle.
+				const float WLength = FMath::Sqrt(WLengthSquared);
+				const FVector2D UnitW = W / WLength;
+				Line.Direction = FVector2D(UnitW.Y, -UnitW.X);
+				U = (CombinedRadius * InvTimeHorizon - WLength) * UnitW;
+			}
+			else
+			{
+				// Project on the legs.
+				const float Leg = FMath::Sqrt(DistSquared - CombinedRadiusSquared);
+				if (DGAvoidance::Det(RelativePosition, W) > 0.f)
+				{
+					Line.Direction = FVector2D(RelativePosition.X * Leg - RelativePosition.Y * CombinedRadius, RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistSquared;
+				}
+				else
+				{
+					Line.Direction = -FVector2D(RelativePosition.X * Leg + RelativePosition.Y * CombinedRadius, -RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistSquared;
+				}
+
+				U = (RelativeVelocity | Line.Direction) * Line.Direction - RelativeVelocity;
+			}
+		}
+		else
+		{
+			// Collision. Project on the cutoff circle of the time step.
+			const FVector2D W = RelativeVelocity - InvTimeStep * RelativePosition;
+			const float WLength = FMath::Max(W.Size(), DGAvoidance::ORCA_EPSILON);
+			const FVector2D UnitW = W / WLength;
+			Line.Direction = FVector2D(UnitW.Y, -UnitW.X);
+			U = (CombinedRadius * InvTimeStep - WLength) * UnitW;
+		}
+
+		Line.Point = Velocity + 0.5f * U;
+		Lines.Add(Line);
+	}
+
+	FVector2D Result;
+	const int32 LineFail = DGAvoidance::LinearProgram2(Lines, MaxSpeed, OptVelocity, false, Result);
+	if (LineFail < Lines.Num())
+	{
+		DGAvoidance::LinearProgram3(Lines, LineFail, MaxSpeed, Result);
+	}
+
+	// Keep the vertical component of the preferred velocity.
+	return FDGMath::VerticalComponent(PreferredVelocity, AxisZ) + AxisX * Result.X + AxisY * Result.Y;
+}
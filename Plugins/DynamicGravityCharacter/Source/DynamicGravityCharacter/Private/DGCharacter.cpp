@@ -3,39 +3,62 @@
 
 #include "DGCharacter.h"
 #include "DGCharacterMovementComponent.h"
+#include "DGMath.h"
 
 #include "GameFramework/Controller.h"
 
-#include "Engine/GameEngine.h"
 
+const FRotator ADGCharacter::DEFAULT_CUSTOM_VIEW_ROTATION_BASE = FRotator(0, 0, 0);
 
-void ADGCharacter::UpdateRawViewRotation(float DeltaTime, UDGCharacterMovementComponent* MovementComponent)
+bool ADGCharacter::GetViewRotationBaseVerticalDirection(const UDGCharacterMovementComponent* MovementComponent, FVector& OutVerticalDirection) const
 {
-	FVector ZVector;
 	switch (ViewRotationBaseMode)
 	{
 	case EViewRotationBaseMode::VRM_Gravity:
-		ZVector = -MovementComponent->Gravity();
-		break;
+		OutVerticalDirection = -MovementComponent->Gravity();
+		return true;
 	case EViewRotationBaseMode::VRM_WorldGravity:
-		ZVector = -MovementComponent->WorldGravity();
-		break;
+		OutVerticalDirection = -MovementComponent->WorldGravity();
+		return true;
 	case EViewRotationBaseMode::VRM_DynamicGravity:
-		ZVector = -MovementComponent->DynamicGravity;
-		break;
+		OutVerticalDirection = -MovementComponent->GetDynamicGravity();
+		return true;
 	case EViewRotationBaseMode::VRM_VerticalDirection:
-		ZVector = MovementComponent->VerticalDirection;
-		break;
+		OutVerticalDirection = MovementComponent->VerticalDirection;
+		return true;
 	case EViewRotationBaseMode::VRM_CharacterRotation:
-		ZVector = GetActorUpVector();
-		break;
-	case EViewRotationBaseMode::VRM_ControlRotation:
-		return;
+		OutVerticalDirection = GetActorUpVector();
+		return true;
 	default:
-		ViewRotationBase = CustomViewRotationBase;
+		return false;
+	}
+}
+
+void ADGCharacter::UpdateRawViewRotation(float DeltaTime, UDGCharacterMovementComponent* MovementComponent)
+{
+	float Alpha = ViewRotationAdjustIntensity < 0 ? 1 : DeltaTime * ViewRotationAdjustIntensity;
+	if (Alpha > 1) Alpha = 1;
+
+	UpdateViewRotationBase(MovementComponent, Alpha);
+}
+
+void ADGCharacter::UpdateViewRotationBase(const UDGCharacterMovementComponent* MovementComponent, float Alpha)
+{
+	FVector ZVector;
+	if (!GetViewRotationBaseVerticalDirection(MovementComponent, ZVector))
+	{
+		if (ViewRotationBaseMode != EViewRotationBaseMode::VRM_ControlRotation)
+		{
+			ViewRotationBase = CustomViewRotationBase;
+			ViewRotationBaseQuat = CustomViewRotationBase.Quaternion();
+		}
 		return;
 	}
 	ZVector = ZVector.GetSafeNormal();
+	if (ZVector.IsZero())
+	{
+		return;
+	}
 
 	FVector CurrentVectorZ = FRotationMatrix(ViewRotationBase.GetEquivalentRotator()).GetScaledAxis(EAxis::Z);
 	float dot = FVector::DotProduct(CurrentVectorZ, ZVector);
@@ -52,20 +75,24 @@ void ADGCharacter::UpdateRawViewRotation(float DeltaTime, UDGCharacterMovementCo
 	const float AngleTolerance = 1e-3f;
 	if (!ViewRotationBase.Equals(NewRotation, AngleTolerance))
 	{
-		float Alpha = ViewRotationAdjustIntensity < 0 ? 1 : DeltaTime * ViewRotationAdjustIntensity;
-		if (Alpha > 1) Alpha = 1;
-
-		FQuat AQuat(ViewRotationBase);
 		FQuat BQuat(NewRotation);
 
-		FQuat Result = FQuat::Slerp(AQuat, BQuat, Alpha);
-		Result.Normalize();
-		ViewRotationBase = Result.Rotator();
+		ViewRotationBaseQuat = FDGMath::Slerp(ViewRotationBaseQuat, BQuat, Alpha);
+		ViewRotationBase = ViewRotationBaseQuat.Rotator();
 
 		ViewRotationBase.Normalize();
 	}
 }
 
+void ADGCharacter::UpdateViewRotationBaseDirection()
+{
+	if (DGCharacterMovement != NULL)
+	{
+		// The same frame as the locally viewed character, so the yaw matches the owning client. Nobody looks through this view, so it doesn't need to be smooth.
+		UpdateViewRotationBase(DGCharacterMovement, 1.f);
+	}
+}
+
 void ADGCharacter::UpdateControlRotation(float DeltaTime, UDGCharacterMovementComponent* MovementComponent)
 {
 	if (ResetingPitchControlRotation || ResetingRollControlRotation || ResetingYawControlRotation)
@@ -110,10 +137,24 @@ void ADGCharacter::UpdateControlRotation(float DeltaTime, UDGCharacterMovementCo
 	}
 }
 
+void ADGCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	DGCharacterMovement = Cast<UDGCharacterMovementComponent>(GetCharacterMovement());
+}
+
 // Sets default values
 ADGCharacter::ADGCharacter(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer.SetDefaultSubobjectClass<UDGCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	ViewRotationBase = FRotator();
+	ViewRotationBaseQuat = FQuat::Identity;
+	DGCharacterMovement = NULL;
+	ViewInputBasisControlRotation = FRotator::ZeroRotator;
+	ViewInputBasisBaseQuat = FQuat::Identity;
+	// Not a direction, so the first call always builds the basis.
+	ViewInputBasisVerticalDirection = FVector::ZeroVector;
+	bUpdateViewRotationOnDedicatedServer = false;
 
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -142,82 +183,121 @@ float ADGCharacter::HorizontalSpeed()
 }
 
 
+FDGMovementInputBasis::FDGMovementInputBasis(const FQuat& WorldRotation, const FVector& VerticalDirection)
+{
+	const FVector ViewForward = WorldRotation.GetAxisX();
+	const FVector ViewRight = WorldRotation.GetAxisY();
+
+	// Same directions as FRotationMatrix::MakeFromZX(VerticalDirection, ViewForward) and FRotationMatrix::MakeFromYZ(ViewRight, VerticalDirection).
+	RadialRight = (VerticalDirection ^ ViewForward).GetSafeNormal();
+	PlanarForward = RadialRight ^ VerticalDirection;
+	PlanarRight = ViewRight;
+	RadialForward = (ViewRight ^ VerticalDirection).GetSafeNormal();
+}
+
+
+const FDGMovementInputBasis& ADGCharacter::GetViewMovementInputBasis()
+{
+	const FVector& VerticalDirection = DGCharacterMovement->VerticalDirection;
+
+	// Keyed on the inputs of GetViewQuat, so a call with an unchanged view is only a compare.
+	const bool bUseBase = Controller != nullptr && ViewRotationBaseMode != EViewRotationBaseMode::VRM_ControlRotation;
+	const FRotator ControlRotation = bUseBase ? Controller->GetControlRotation() : ACharacter::GetViewRotation();
+	const FQuat& BaseQuat = bUseBase ? ViewRotationBaseQuat : FQuat::Identity;
+	if (ViewInputBasisControlRotation != ControlRotation || ViewInputBasisBaseQuat != BaseQuat || ViewInputBasisVerticalDirection != VerticalDirection)
+	{
+		ViewInputBasis = FDGMovementInputBasis(BaseQuat * ControlRotation.Quaternion(), VerticalDirection);
+		ViewInputBasisControlRotation = ControlRotation;
+		ViewInputBasisBaseQuat = BaseQuat;
+		ViewInputBasisVerticalDirection = VerticalDirection;
+	}
+
+	return ViewInputBasis;
+}
+
+
 void ADGCharacter::AddForwardPlanarMovementInput(FRotator WorldRotation, float ScaleValue, bool bForce)
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	FVector ForwardViewRotationDirection = FRotationMatrix(WorldRotation).GetScaledAxis(EAxis::X);
-	FRotator ForwardInputRotation = FRotationMatrix::MakeFromZX(MovementComponent->VerticalDirection, ForwardViewRotationDirection).Rotator();
-	FVector ForwardInputDirection = FRotationMatrix(ForwardInputRotation).GetScaledAxis(EAxis::X);
-	AddMovementInput(ForwardInputDirection, ScaleValue, bForce);
+	AddMovementInput(FDGMovementInputBasis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection).PlanarForward, ScaleValue, bForce);
 }
 
 void ADGCharacter::AddForwardPlanarMovementInputWithViewRotationAsWorldRotation(float ScaleValue, bool bForce)
 {
-	AddForwardPlanarMovementInput(GetViewRotation(), ScaleValue, bForce);
+	AddMovementInput(GetViewMovementInputBasis().PlanarForward, ScaleValue, bForce);
 }
 
 
 void ADGCharacter::AddRightPlanarMovementInput(FRotator WorldRotation, float ScaleValue, bool bForce)
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	FVector RightViewRotationDirection = FRotationMatrix(WorldRotation).GetScaledAxis(EAxis::Y);
-	FRotator RightInputRotation = FRotationMatrix::MakeFromYZ(RightViewRotationDirection, MovementComponent->VerticalDirection).Rotator();
-	FVector RightInputDirection = FRotationMatrix(RightInputRotation).GetScaledAxis(EAxis::Y);
-	AddMovementInput(RightInputDirection, ScaleValue, bForce);
+	AddMovementInput(FDGMovementInputBasis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection).PlanarRight, ScaleValue, bForce);
 }
 
 void ADGCharacter::AddRightPlanarMovementInputWithViewRotationAsWorldRotation(float ScaleValue, bool bForce)
 {
-	AddRightPlanarMovementInput(GetViewRotation(), ScaleValue, bForce);
+	AddMovementInput(GetViewMovementInputBasis().PlanarRight, ScaleValue, bForce);
 }
 
 
 void ADGCharacter::AddForwardRadialMovementInput(FRotator WorldRotation, float ScaleValue, bool bForce)
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	FVector RightViewRotationDirection = FRotationMatrix(WorldRotation).GetScaledAxis(EAxis::Y);
-	FRotator RightInputRotation = FRotationMatrix::MakeFromYZ(RightViewRotationDirection, MovementComponent->VerticalDirection).Rotator();
-	FVector ForwardInputDirection = FRotationMatrix(RightInputRotation).GetScaledAxis(EAxis::X);
-	AddMovementInput(ForwardInputDirection, ScaleValue, bForce);
+	AddMovementInput(FDGMovementInputBasis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection).RadialForward, ScaleValue, bForce);
 }
 
 void ADGCharacter::AddForwardRadialMovementInputWithViewRotationAsWorldRotation(float ScaleValue, bool bForce)
 {
-	AddForwardRadialMovementInput(GetViewRotation(), ScaleValue, bForce);
+	AddMovementInput(GetViewMovementInputBasis().RadialForward, ScaleValue, bForce);
 }
 
 
 void ADGCharacter::AddRightRadialMovementInput(FRotator WorldRotation, float ScaleValue, bool bForce)
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	FVector ForwardViewRotationDirection = FRotationMatrix(WorldRotation).GetScaledAxis(EAxis::X);
-	FRotator ForwardInputRotation = FRotationMatrix::MakeFromZX(MovementComponent->VerticalDirection, ForwardViewRotationDirection).Rotator();
-	FVector RightInputDirection = FRotationMatrix(ForwardInputRotation).GetScaledAxis(EAxis::Y);
-	AddMovementInput(RightInputDirection, ScaleValue, bForce);
+	AddMovementInput(FDGMovementInputBasis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection).RadialRight, ScaleValue, bForce);
 }
 
 void ADGCharacter::AddRightRadialMovementInputWithViewRotationAsWorldRotation(float ScaleValue, bool bForce)
 {
-	AddRightRadialMovementInput(GetViewRotation(), ScaleValue, bForce);
+	AddMovementInput(GetViewMovementInputBasis().RadialRight, ScaleValue, bForce);
+}
+
+
+void ADGCharacter::AddPlanarMovementInput(FRotator WorldRotation, FVector2D Axis, bool bForce)
+{
+	const FDGMovementInputBasis Basis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection);
+	AddMovementInput(Basis.PlanarForward * Axis.X + Basis.PlanarRight * Axis.Y, 1.f, bForce);
+}
+
+void ADGCharacter::AddRadialMovementInput(FRotator WorldRotation, FVector2D Axis, bool bForce)
+{
+	const FDGMovementInputBasis Basis(WorldRotation.Quaternion(), DGCharacterMovement->VerticalDirection);
+	AddMovementInput(Basis.RadialForward * Axis.X + Basis.RadialRight * Axis.Y, 1.f, bForce);
+}
+
+void ADGCharacter::AddPlanarMovementInputWithViewRotationAsWorldRotation(FVector2D Axis, bool bForce)
+{
+	const FDGMovementInputBasis& Basis = GetViewMovementInputBasis();
+	AddMovementInput(Basis.PlanarForward * Axis.X + Basis.PlanarRight * Axis.Y, 1.f, bForce);
+}
+
+void ADGCharacter::AddRadialMovementInputWithViewRotationAsWorldRotation(FVector2D Axis, bool bForce)
+{
+	const FDGMovementInputBasis& Basis = GetViewMovementInputBasis();
+	AddMovementInput(Basis.RadialForward * Axis.X + Basis.RadialRight * Axis.Y, 1.f, bForce);
 }
 
 FVector ADGCharacter::VerticalVelocity()
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	return GetVelocity().ProjectOnToNormal(MovementComponent->VerticalDirection);
+	return FDGMath::VerticalComponent(GetVelocity(), DGCharacterMovement->VerticalDirection);
 }
 
 FVector ADGCharacter::HorizontalVelocity()
 {
-	return GetVelocity() - VerticalVelocity();
+	return FDGMath::HorizontalComponent(GetVelocity(), DGCharacterMovement->VerticalDirection);
 }
 
 FHorizontalAndVerticalVelocities ADGCharacter::HorizontalAndVerticalVelocities()
 {
-	const UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	const FVector Velocity = GetVelocity();
-	const FVector VerticalVelocity = Velocity.ProjectOnToNormal(MovementComponent->VerticalDirection);
-	const FVector HorizontalVelocity = Velocity - VerticalVelocity;
+	FVector VerticalVelocity, HorizontalVelocity;
+	FDGMath::Decompose(GetVelocity(), DGCharacterMovement->VerticalDirection, VerticalVelocity, HorizontalVelocity);
 	return FHorizontalAndVerticalVelocities(HorizontalVelocity, VerticalVelocity);
 }
 
@@ -225,12 +305,28 @@ FRotator ADGCharacter::GetViewRotation() const
 {
 	if (Controller != nullptr && ViewRotationBaseMode != EViewRotationBaseMode::VRM_ControlRotation)
 	{
-		return FRotator(FQuat(ViewRotationBase) * FQuat(Controller->GetControlRotation())).GetNormalized();
+		return FRotator(GetViewQuat()).GetNormalized();
 	}
 
 	return ACharacter::GetViewRotation();
 }
 
+const FDGKinematicsSnapshot& ADGCharacter::GetKinematics() const
+{
+	static const FDGKinematicsSnapshot NoKinematics;
+	return DGCharacterMovement != NULL ? DGCharacterMovement->GetKinematics() : NoKinematics;
+}
+
+FQuat ADGCharacter::GetViewQuat() const
+{
+	if (Controller != nullptr && ViewRotationBaseMode != EViewRotationBaseMode::VRM_ControlRotation)
+	{
+		return ViewRotationBaseQuat * Controller->GetControlRotation().Quaternion();
+	}
+
+	return ACharacter::GetViewRotation().Quaternion();
+}
+
 void ADGCharacter::ResetControlRotation()
 {
 	ResetingPitchControlRotation = ResetingYawControlRotation = ResetingRollControlRotation = true;
@@ -287,9 +383,27 @@ void ADGCharacter::AddControllerRollInput(float Val)
 
 void ADGCharacter::TickActor(float DeltaTime, ELevelTick TickType, FActorTickFunction& ThisTickFunction)
 {
-	UDGCharacterMovementComponent* MovementComponent = Cast<UDGCharacterMovementComponent>(GetMovementComponent());
-	UpdateRawViewRotation(DeltaTime, MovementComponent);
-	UpdateControlRotation(DeltaTime, MovementComponent);
+	if (DGCharacterMovement != NULL)
+	{
+#if UE_SERVER
+		// A server build has no local viewer, but its AI is locally controlled and aims with the view rotation.
+		if (Controller != nullptr && (bUpdateViewRotationOnDedicatedServer || IsLocallyControlled()))
+		{
+			UpdateViewRotationBaseDirection();
+		}
+#else
+		if (IsLocallyControlled() && IsPlayerControlled())
+		{
+			UpdateRawViewRotation(DeltaTime, DGCharacterMovement);
+			UpdateControlRotation(DeltaTime, DGCharacterMovement);
+		}
+		else if (Controller != nullptr && (bUpdateViewRotationOnDedicatedServer || IsLocallyControlled() || !IsRunningDedicatedServer()))
+		{
+			// AI and remote players only need the direction of their view, for aiming and perception.
+			UpdateViewRotationBaseDirection();
+		}
+#endif
+	}
 
 	AActor::TickActor(DeltaTime, TickType, ThisTickFunction);
 }
\ No newline at end of file
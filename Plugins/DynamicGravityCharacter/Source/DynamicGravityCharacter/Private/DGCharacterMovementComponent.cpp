@@ -2,15 +2,27 @@
 
 
 #include "DGCharacterMovementComponent.h"
+#include "DGAvoidanceSubsystem.h"
 #include "DGCharacter.h"
+#include "DGGravitySubsystem.h"
+#include "DGMath.h"
+#include "DGMovementSettings.h"
+#include "DGRootMotionSource.h"
+#include "DGSmoothNormalsUserData.h"
+#include "DynamicGravityCharacter.h"
+#include "AI/NavigationSystemBase.h"
+#include "Components/BrushComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Engine/World.h"
+#include "GameFramework/PhysicsVolume.h"
 #include "GameFramework/PlayerController.h"
 
 #include "DrawDebugHelpers.h"
 #include "EngineGlobals.h"
 
 #include "Engine/GameEngine.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
 
 
 /**
@@ -18,12 +30,37 @@
  */
 DECLARE_CYCLE_STAT(TEXT("Char AdjustFloorHeight"), STAT_CharAdjustFloorHeight, STATGROUP_Character);
 DECLARE_CYCLE_STAT(TEXT("Char PhysWalking"), STAT_CharPhysWalking, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("Char PhysNavWalking"), STAT_CharPhysNavWalking, STATGROUP_Character);
 DECLARE_CYCLE_STAT(TEXT("Char PhysFalling"), STAT_CharPhysFalling, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("Char PhysFlying"), STAT_CharPhysFlying, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("Char PhysSwimming"), STAT_CharPhysSwimming, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("Char PhysOrbital"), STAT_CharPhysOrbital, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("Char PredictFallTrajectory"), STAT_CharPredictFallTrajectory, STATGROUP_Character);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Falling Substeps"), STAT_DGFallingSubsteps, STATGROUP_DynamicGravity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Falling Sweeps"), STAT_DGFallingSweeps, STATGROUP_DynamicGravity);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Falling Time Step (ms)"), STAT_DGFallingTimeStep, STATGROUP_DynamicGravity);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Falling Turn Per Substep (deg)"), STAT_DGFallingTurnPerSubstep, STATGROUP_DynamicGravity);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Falling Clearance"), STAT_DGFallingClearance, STATGROUP_DynamicGravity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Falling Unswept Moves"), STAT_DGFallingUnsweptMoves, STATGROUP_DynamicGravity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fall Clearance Probes"), STAT_DGFallClearanceProbes, STATGROUP_DynamicGravity);
 
 
 const float MAX_STEP_SIDE_Z = 0.08f;	// maximum z value for the normal on the vertical side of steps
 
 
+const FVector UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION = FVector::UpVector;
+constexpr EWalkableFloorNormalMode UDGCharacterMovementComponent::DEFAULT_WALKABLE_FLOOR_NORMAL_MODE;
+const FVector UDGCharacterMovementComponent::DEFAULT_CUSTOM_WALKABLE_FLOOR_NORMAL = FVector::UpVector;
+constexpr EJumpDirectionMode UDGCharacterMovementComponent::DEFAULT_JUMP_DIRECTION_MODE;
+const FVector UDGCharacterMovementComponent::DEFAULT_CUSTOM_JUMP_DIRECTION = FVector::UpVector;
+constexpr EPhysicsRotationVerticalDirectionMode UDGCharacterMovementComponent::DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE;
+const FVector UDGCharacterMovementComponent::DEFAULT_VERTICAL_DIRECTION = FVector::UpVector;
+constexpr float UDGCharacterMovementComponent::DEFAULT_LERP_ROTATION_RATE;
+const FRotator UDGCharacterMovementComponent::DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION = FRotator::ZeroRotator;
+constexpr float UDGCharacterMovementComponent::VERTICAL_SLOPE_NORMAL_Z;
+
+
 UDGCharacterMovementComponent::UDGCharacterMovementComponent()
 {
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
@@ -36,11 +73,289 @@ UDGCharacterMovementComponent::UDGCharacterMovementComponent()
 	CustomJumpDirection = DEFAULT_CUSTOM_JUMP_DIRECTION;
 
 	DynamicGravity = FVector::ZeroVector;
+	FieldGravity = FVector::ZeroVector;
 	bIgnoreWorldGravityIfDynamicGravityIsNotZero = false;
 
 	RotationAdjustIntensity = DEFAULT_LERP_ROTATION_RATE;
 	PhysicsRotationVerticalDirectionMode = DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE;
 	RotationRate = DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION;
+
+	CachedCollisionObjectType = ECC_Pawn;
+	CachedMoveIgnoreMask = 0;
+	bCachedTraceComplexOnMove = false;
+	bCachedReturnMaterialOnMove = false;
+	bCachedCollisionParamsValid = false;
+
+	bUseFullOldFloor = false;
+
+	MovementSettings = NULL;
+
+	NavWalkingSurfacePoint = FVector::ZeroVector;
+	NavWalkingSurfaceNormal = DEFAULT_VERTICAL_DIRECTION;
+	NavWalkingSurfaceVerticalDirection = DEFAULT_VERTICAL_DIRECTION;
+	NavWalkingSurfaceAge = 0.f;
+	bNavWalkingSurfaceValid = false;
+
+	SurfaceNavigationGraph = NULL;
+	SurfacePathAcceptanceRadius = 50.f;
+	bAlignGravityToSurfacePath = false;
+	SurfacePathIndex = 0;
+	SurfacePathSavedDynamicGravity = FVector::ZeroVector;
+	SurfacePathSavedVerticalDirection = DEFAULT_VERTICAL_DIRECTION;
+	SurfacePathGravityMagnitude = 0.f;
+	bSurfacePathGravitySaved = false;
+
+	bUseTangentAvoidance = false;
+	AvoidanceConsiderationRadius = 500.f;
+	AvoidanceTimeHorizon = 1.5f;
+	MaxAvoidanceNeighbors = 8;
+	AvoidanceSubsystem = NULL;
+
+	bSampleGravityFields = false;
+
+	bAdaptiveFallingSubsteps = false;
+	MaxFallingTurnAnglePerSubstep = 3.f;
+	MinFallingTimeStep = 0.0166f;
+	MaxFallingTimeStep = 0.1f;
+	bSkipFallSweepsInClearance = false;
+	FallClearanceProbeRadius = 500.f;
+	FallClearanceMaxAge = 0.5f;
+	AdaptiveFallingTimeStep = 0.05f;
+	LastFallingGravityNormal = FVector::ZeroVector;
+	FallClearanceCenter = FVector::ZeroVector;
+	FallClearanceRadius = 0.f;
+	FallClearanceProbeTime = 0.f;
+	bFallClearanceValid = false;
+
+	bEnableOrbitalMovement = false;
+	OrbitalEnterAltitude = 5000.f;
+	OrbitalExitAltitude = 3000.f;
+	OrbitalTimeStep = 0.05f;
+
+	bCacheFloorInBaseFrame = true;
+	BaseFloorCacheTolerance = 0.5f;
+	BaseFloorCacheRadius = 20.f;
+	bRotateDynamicGravityWithBase = false;
+	BaseFloorCapsuleLocation = FVector::ZeroVector;
+	BaseFloorLocation = FVector::ZeroVector;
+	BaseFloorImpactPoint = FVector::ZeroVector;
+	BaseFloorNormal = FVector::ZeroVector;
+	BaseFloorImpactNormal = FVector::ZeroVector;
+	BaseFloorUp = FVector::ZeroVector;
+	BaseFloorDist = 0.f;
+	BaseFloorLineDist = 0.f;
+	BaseFloorWrittenImpactPoint = FVector::ZeroVector;
+	bBaseFloorValid = false;
+
+	bSmoothFloorImpactNormal = true;
+	SmoothFloorNormalPoint = FVector::ZeroVector;
+	SmoothFloorNormalFaceIndex = INDEX_NONE;
+	SmoothFloorNormal = FVector::ZeroVector;
+
+	VerticalDirectionChangeThreshold = 1.f;
+	GravityChangeAngleThreshold = 1.f;
+	GravityChangeMagnitudeThreshold = 10.f;
+	WalkableNormalChangeThreshold = 1.f;
+	NotifiedVerticalDirection = FVector::ZeroVector;
+	NotifiedGravity = FVector::ZeroVector;
+	NotifiedWalkableNormal = FVector::ZeroVector;
+	bNotifiedWalkableNormalValid = false;
+	bKinematicsNormalsValid = false;
+}
+
+EWalkableFloorNormalMode UDGCharacterMovementComponent::GetWalkableFloorNormalMode() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_WalkableFloorNormalMode ? MovementSettings->WalkableFloorNormalMode : WalkableFloorNormalMode;
+}
+
+FVector UDGCharacterMovementComponent::GetCustomWalkableFloorNormal() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_CustomWalkableFloorNormal ? MovementSettings->CustomWalkableFloorNormal : CustomWalkableFloorNormal;
+}
+
+EJumpDirectionMode UDGCharacterMovementComponent::GetJumpDirectionMode() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_JumpDirectionMode ? MovementSettings->JumpDirectionMode : JumpDirectionMode;
+}
+
+FVector UDGCharacterMovementComponent::GetCustomJumpDirection() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_CustomJumpDirection ? MovementSettings->CustomJumpDirection : CustomJumpDirection;
+}
+
+float UDGCharacterMovementComponent::GetRotationAdjustIntensity() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_RotationAdjustIntensity ? MovementSettings->RotationAdjustIntensity : RotationAdjustIntensity;
+}
+
+EPhysicsRotationVerticalDirectionMode UDGCharacterMovementComponent::GetPhysicsRotationVerticalDirectionMode() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_PhysicsRotationVerticalDirectionMode ? MovementSettings->PhysicsRotationVerticalDirectionMode : PhysicsRotationVerticalDirectionMode;
+}
+
+FRotator UDGCharacterMovementComponent::GetCustomPhysicsRotationVerticalDirection() const
+{
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_CustomPhysicsRotationVerticalDirection ? MovementSettings->CustomPhysicsRotationVerticalDirection : RotationRate;
+}
+
+bool UDGCharacterMovementComponent::GetIgnoreWorldGravityIfDynamicGravityIsNotZero() const
+{
+	// A surface path replaces the whole gravity while it aligns it.
+	if (bSurfacePathGravitySaved)
+	{
+		return true;
+	}
+
+	return MovementSettings != NULL && !MovementSettingsOverrides.bOverride_bIgnoreWorldGravityIfDynamicGravityIsNotZero ? MovementSettings->bIgnoreWorldGravityIfDynamicGravityIsNotZero : bIgnoreWorldGravityIfDynamicGravityIsNotZero;
+}
+
+void UDGCharacterMovementComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	UpdateTangentAvoidanceRegistration();
+}
+
+void UDGCharacterMovementComponent::OnUnregister()
+{
+	if (AvoidanceSubsystem != NULL)
+	{
+		AvoidanceSubsystem->UnregisterAgent(this);
+		AvoidanceSubsystem = NULL;
+	}
+
+	Super::OnUnregister();
+}
+
+void UDGCharacterMovementComponent::SetTangentAvoidanceEnabled(bool bEnable)
+{
+	bUseTangentAvoidance = bEnable;
+	UpdateTangentAvoidanceRegistration();
+}
+
+void UDGCharacterMovementComponent::UpdateTangentAvoidanceRegistration()
+{
+	UWorld* World = GetWorld();
+	const bool bShouldRegister = bUseTangentAvoidance && IsRegistered() && World != NULL && World->IsGameWorld();
+
+	if (bShouldRegister && AvoidanceSubsystem == NULL)
+	{
+		AvoidanceSubsystem = World->GetSubsystem<UDGAvoidanceSubsystem>();
+		if (AvoidanceSubsystem != NULL)
+		{
+			AvoidanceSubsystem->RegisterAgent(this);
+		}
+	}
+	else if (!bShouldRegister && AvoidanceSubsystem != NULL)
+	{
+		AvoidanceSubsystem->UnregisterAgent(this);
+		AvoidanceSubsystem = NULL;
+	}
+}
+
+void UDGCharacterMovementComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(CachedMoveIgnoreActors.GetAllocatedSize());
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(CachedMoveIgnoreComponents.GetAllocatedSize());
+}
+
+#if WITH_EDITOR
+void UDGCharacterMovementComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FName PropertyName = PropertyChangedEvent.GetPropertyName();
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, OrbitalEnterAltitude) || PropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, OrbitalExitAltitude))
+	{
+		// The character must fall below the altitude where it started orbiting, or it would switch modes every step.
+		OrbitalExitAltitude = FMath::Min(OrbitalExitAltitude, OrbitalEnterAltitude);
+	}
+
+	// An edit of a value that the asset provides would be ignored, so it overrides the asset.
+	if (MovementSettings != NULL)
+	{
+		const FName MemberPropertyName = PropertyChangedEvent.GetMemberPropertyName();
+		FDGMovementSettingsOverrides& Overrides = MovementSettingsOverrides;
+		if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, WalkableFloorNormalMode))
+		{
+			Overrides.bOverride_WalkableFloorNormalMode = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, CustomWalkableFloorNormal))
+		{
+			Overrides.bOverride_CustomWalkableFloorNormal = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, JumpDirectionMode))
+		{
+			Overrides.bOverride_JumpDirectionMode = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, CustomJumpDirection))
+		{
+			Overrides.bOverride_CustomJumpDirection = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, RotationAdjustIntensity))
+		{
+			Overrides.bOverride_RotationAdjustIntensity = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, PhysicsRotationVerticalDirectionMode))
+		{
+			Overrides.bOverride_PhysicsRotationVerticalDirectionMode = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, RotationRate))
+		{
+			Overrides.bOverride_CustomPhysicsRotationVerticalDirection = true;
+		}
+		else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UDGCharacterMovementComponent, bIgnoreWorldGravityIfDynamicGravityIsNotZero))
+		{
+			Overrides.bOverride_bIgnoreWorldGravityIfDynamicGravityIsNotZero = true;
+		}
+	}
+}
+#endif
+
+const FCollisionQueryParams& UDGCharacterMovementComponent::GetCachedCollisionParams(FName TraceTag) const
+{
+	const UPrimitiveComponent* Primitive = UpdatedPrimitive;
+	if (Primitive == NULL)
+	{
+		bCachedCollisionParamsValid = false;
+		CachedCollisionQueryParams = FCollisionQueryParams(TraceTag, false, CharacterOwner);
+		CachedCollisionResponseParams = FCollisionResponseParams();
+		return CachedCollisionQueryParams;
+	}
+
+	const FCollisionResponseContainer& Responses = Primitive->GetCollisionResponseToChannels();
+	const bool bStillValid = bCachedCollisionParamsValid
+		&& CachedCollisionOwner.Get() == CharacterOwner
+		&& CachedCollisionObjectType == Primitive->GetCollisionObjectType()
+		&& CachedMoveIgnoreMask == Primitive->GetMoveIgnoreMask()
+		&& bCachedTraceComplexOnMove == (bool)Primitive->bTraceComplexOnMove
+		&& bCachedReturnMaterialOnMove == (bool)Primitive->bReturnMaterialOnMove
+		&& FMemory::Memcmp(CachedCollisionResponses.EnumArray, Responses.EnumArray, sizeof(Responses.EnumArray)) == 0
+		&& CachedMoveIgnoreActors == Primitive->GetMoveIgnoreActors()
+		&& CachedMoveIgnoreComponents == Primitive->GetMoveIgnoreComponents();
+
+	if (!bStillValid)
+	{
+		CachedCollisionQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(DGCharacterMovement), false, CharacterOwner);
+		CachedCollisionResponseParams = FCollisionResponseParams();
+		InitCollisionParams(CachedCollisionQueryParams, CachedCollisionResponseParams);
+
+		CachedCollisionOwner = CharacterOwner;
+		CachedCollisionObjectType = Primitive->GetCollisionObjectType();
+		CachedMoveIgnoreMask = Primitive->GetMoveIgnoreMask();
+		bCachedTraceComplexOnMove = Primitive->bTraceComplexOnMove;
+		bCachedReturnMaterialOnMove = Primitive->bReturnMaterialOnMove;
+		CachedCollisionResponses = Responses;
+		CachedMoveIgnoreActors = Primitive->GetMoveIgnoreActors();
+		CachedMoveIgnoreComponents = Primitive->GetMoveIgnoreComponents();
+		bCachedCollisionParamsValid = true;
+	}
+
+	CachedCollisionQueryParams.TraceTag = TraceTag;
+	CachedCollisionQueryParams.bReturnFaceIndex = bSmoothFloorImpactNormal && GetWalkableFloorNormalMode() == EWalkableFloorNormalMode::WFN_FloorImpactNormal;
+	return CachedCollisionQueryParams;
 }
 
 void UDGCharacterMovementComponent::UpdateVerticalDirection()
@@ -80,7 +395,7 @@ void UDGCharacterMovementComponent::UpdateVerticalDirection()
 
 FVector UDGCharacterMovementComponent::WalkableFloorNormal() const
 {
-	switch (WalkableFloorNormalMode)
+	switch (GetWalkableFloorNormalMode())
 	{
 	case EWalkableFloorNormalMode::WFN_Gravity:
 		return -GravityNormal();
@@ -92,17 +407,41 @@ FVector UDGCharacterMovementComponent::WalkableFloorNormal() const
 		return CharacterOwner->GetActorUpVector();
 	case EWalkableFloorNormalMode::WFN_FloorImpactNormal:
 		if (CurrentFloor.bWalkableFloor)
-			return CurrentFloor.HitResult.ImpactNormal;
+			return GetSmoothFloorImpactNormal();
 	case EWalkableFloorNormalMode::WFN_NoFloor:
 		return FVector();
 	default:
-		return CustomWalkableFloorNormal;
+		return GetCustomWalkableFloorNormal();
+	}
+}
+
+FVector UDGCharacterMovementComponent::GetSmoothFloorImpactNormal() const
+{
+	const FHitResult& Hit = CurrentFloor.HitResult;
+	if (!bSmoothFloorImpactNormal || Hit.FaceIndex == INDEX_NONE)
+	{
+		return Hit.ImpactNormal;
+	}
+
+	// Looked up once per floor hit.
+	if (SmoothFloorNormalFaceIndex != Hit.FaceIndex || SmoothFloorNormalPoint != Hit.ImpactPoint || SmoothFloorNormalComponent != Hit.Component)
+	{
+		if (!UDGSmoothNormalsUserData::GetSmoothNormal(Hit, SmoothFloorNormal))
+		{
+			SmoothFloorNormal = Hit.ImpactNormal;
+		}
+
+		SmoothFloorNormalComponent = Hit.Component;
+		SmoothFloorNormalPoint = Hit.ImpactPoint;
+		SmoothFloorNormalFaceIndex = Hit.FaceIndex;
 	}
+
+	return SmoothFloorNormal;
 }
 
 FVector UDGCharacterMovementComponent::JumpDirection() const
 {
-	switch (JumpDirectionMode)
+	switch (GetJumpDirectionMode())
 	{
 	case EJumpDirectionMode::JDM_Gravity:
 		return -GravityNormal();
@@ -114,7 +453,7 @@ FVector UDGCharacterMovementComponent::JumpDirection() const
 		return VerticalDirection;
 		return FVector();
 	default:
-		return CustomWalkableFloorNormal;
+		return GetCustomWalkableFloorNormal();
 	}
 }
 
@@ -132,6 +471,7 @@ void UDGCharacterMovementComponent::OnMovementModeChanged(EMovementMode Previous
 		// Walking uses only horizontal velocity
 		Velocity -= Velocity.ProjectOnToNormal(VerticalDirection);
 		SetNavWalkingPhysics(true);
+		bNavWalkingSurfaceValid = false;
 	}
 	else if (PreviousMovementMode == MOVE_NavWalking)
 	{
@@ -161,6 +501,11 @@ void UDGCharacterMovementComponent::OnMovementModeChanged(EMovementMode Previous
 		FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false);
 		AdjustFloorHeight();
 		SetBaseFromFloor(CurrentFloor);
+
+		if (PreviousMovementMode == MOVE_Falling)
+		{
+			EndGravityJumpForcesOnLanded();
+		}
 	}
 	else
 	{
@@ -186,6 +531,9 @@ void UDGCharacterMovementComponent::OnMovementModeChanged(EMovementMode Previous
 
 	if (MovementMode == MOVE_Falling && PreviousMovementMode != MOVE_Falling)
 	{
+		LastFallingGravityNormal = FVector::ZeroVector;
+		bFallClearanceValid = false;
+
 		IPathFollowingAgentInterface* PFAgent = GetPathFollowingAgent();
 		if (PFAgent)
 		{
@@ -198,7 +546,7 @@ void UDGCharacterMovementComponent::OnMovementModeChanged(EMovementMode Previous
 
 FVector UDGCharacterMovementComponent::ConstrainInputAcceleration(const FVector& InputAcceleration) const
 {
-	FVector VerticalInputAcceleration = InputAcceleration.ProjectOnToNormal(VerticalDirection);
+	const FVector VerticalInputAcceleration = FDGMath::VerticalComponent(InputAcceleration, VerticalDirection);
 
 	// walking or falling pawns ignore Vertical sliding
 	if (!VerticalInputAcceleration.IsNearlyZero() && (IsMovingOnGround() || IsFalling()))
@@ -295,8 +643,9 @@ void UDGCharacterMovementComponent::TwoWallAdjust(FVector& Delta, const FHitResu
 				const FVector ScaledDelta = Delta.GetSafeNormal() * InDelta.Size();
 				const float ScaledDeltaZ = FVector::DotProduct(ScaledDelta, VerticalDirection);
 
-				const FVector InDeltaProjectedOnToFloorDirection = InDelta.ProjectOnToNormal(VerticalDirection);
-				Delta = Time * (InDelta - InDeltaProjectedOnToFloorDirection + InDeltaProjectedOnToFloorDirection.GetSafeNormal() * ScaledDeltaZ / HitNormalZ); //FVector(InDelta.X, InDelta.Y, ScaledDelta.Z / Hit.Normal.Z)*Time;
+				FVector InDeltaProjectedOnToFloorDirection, InDeltaHorizontal;
+				FDGMath::Decompose(InDelta, VerticalDirection, InDeltaProjectedOnToFloorDirection, InDeltaHorizontal);
+				Delta = Time * (InDeltaHorizontal + InDeltaProjectedOnToFloorDirection.GetSafeNormal() * ScaledDeltaZ / HitNormalZ); //FVector(InDelta.X, InDelta.Y, ScaledDelta.Z / Hit.Normal.Z)*Time;
 
 				// Should never exceed MaxStepHeight in vertical component, so rescale if necessary.
 				// This should be rare (Hit.Normal.Z above would have been very small) but we'd rather lose horizontal velocity than go too high.
@@ -309,7 +658,7 @@ void UDGCharacterMovementComponent::TwoWallAdjust(FVector& Delta, const FHitResu
 			else
 			{
 				//Delta.Z = 0.f;
-				Delta = Delta - Delta.ProjectOnToNormal(VerticalDirection);
+				Delta = FDGMath::HorizontalComponent(Delta, VerticalDirection);
 			}
 		}
 		else if (DeltaZ < 0.f)
@@ -318,7 +667,7 @@ void UDGCharacterMovementComponent::TwoWallAdjust(FVector& Delta, const FHitResu
 			if (CurrentFloor.FloorDist < MIN_FLOOR_DIST && CurrentFloor.bBlockingHit)
 			{
 				//Delta.Z = 0.f;
-				Delta = Delta - Delta.ProjectOnToNormal(VerticalDirection);
+				Delta = FDGMath::HorizontalComponent(Delta, VerticalDirection);
 			}
 		}
 	}
@@ -458,7 +807,11 @@ bool UDGCharacterMovementComponent::StepUp(const FVector& FloorDirection, const
 		return false;
 	}
 
-	FStepDownResult StepDownResult;
+	if (OutStepDownResult != NULL)
+	{
+		OutStepDownResult->bComputedFloor = false;
+	}
+
 	if (Hit.IsValidBlockingHit())
 	{
 		const float HitImpactPointZ = FVector::DotProduct(Hit.ImpactPoint, -FloorDirection);
@@ -514,7 +867,8 @@ bool UDGCharacterMovementComponent::StepUp(const FVector& FloorDirection, const
 		// See if we can validate the floor as a result of this step down. In almost all cases this should succeed, and we can avoid computing the floor outside this method.
 		if (OutStepDownResult != NULL)
 		{
-			FindFloor(UpdatedComponent->GetComponentLocation(), StepDownResult.FloorResult, false, &Hit);
+			// Find the floor straight into the output to avoid copying the result around.
+			FindFloor(UpdatedComponent->GetComponentLocation(), OutStepDownResult->FloorResult, false, &Hit);
 
 			// Reject unwalkable normals if we end up higher than our initial height.
 			// It's fine to walk down onto an unwalkable surface, don't reject those moves.
@@ -522,23 +876,17 @@ bool UDGCharacterMovementComponent::StepUp(const FVector& FloorDirection, const
 			{
 				// We should reject the floor result if we are trying to step up an actual step where we are not able to perch (this is rare).
 				// In those cases we should instead abort the step up and try to slide along the stair.
-				if (!StepDownResult.FloorResult.bBlockingHit && StepSideZ < MAX_STEP_SIDE_Z)
+				if (!OutStepDownResult->FloorResult.bBlockingHit && StepSideZ < MAX_STEP_SIDE_Z)
 				{
 					ScopedStepUpMovement.RevertMove();
 					return false;
 				}
 			}
 
-			StepDownResult.bComputedFloor = true;
+			OutStepDownResult->bComputedFloor = true;
 		}
 	}
 
-	// Copy step down result.
-	if (OutStepDownResult != NULL)
-	{
-		*OutStepDownResult = StepDownResult;
-	}
-
 	// Don't recalculate velocity based on this height adjustment, if considering vertical adjustments.
 	bJustTeleported |= !bMaintainHorizontalGroundVelocity;
 
@@ -599,6 +947,85 @@ void UDGCharacterMovementComponent::RequestPathMove(const FVector& MoveInput)
 	Super::RequestPathMove(AdjustedMoveInput);
 }
 
+bool UDGCharacterMovementComponent::MoveAlongSurface(FVector Goal)
+{
+	StopMovingAlongSurface();
+
+	if (SurfaceNavigationGraph == NULL || !HasValidData())
+	{
+		return false;
+	}
+
+	// Keeps the start on the surface under the feet, not on a thin wall or floor behind it, and the goal on the surface it is on.
+	if (!SurfaceNavigationGraph->FindPath(GetGravityFeetLocation(), Goal, SurfacePath, VerticalDirection, -GravityAt(Goal).GetSafeNormal()))
+	{
+		return false;
+	}
+
+	SurfacePathIndex = 0;
+
+	if (bAlignGravityToSurfacePath)
+	{
+		// The path only turns the gravity, with the magnitude that it had when the path started.
+		SurfacePathSavedDynamicGravity = DynamicGravity;
+		SurfacePathSavedVerticalDirection = VerticalDirection;
+		SurfacePathGravityMagnitude = FMath::Max(Gravity().Size(), FMath::Abs(GetGravityZ()));
+		bSurfacePathGravitySaved = true;
+	}
+
+	return true;
+}
+
+void UDGCharacterMovementComponent::StopMovingAlongSurface()
+{
+	SurfacePath.Reset();
+	SurfacePathIndex = 0;
+
+	if (bSurfacePathGravitySaved)
+	{
+		DynamicGravity = SurfacePathSavedDynamicGravity;
+		VerticalDirection = SurfacePathSavedVerticalDirection;
+		bSurfacePathGravitySaved = false;
+	}
+}
+
+void UDGCharacterMovementComponent::StopActiveMovement()
+{
+	Super::StopActiveMovement();
+
+	StopMovingAlongSurface();
+}
+
+void UDGCharacterMovementComponent::FollowSurfacePath(float DeltaTime)
+{
+	if (!SurfacePath.IsValid() || !HasValidData())
+	{
+		return;
+	}
+
+	const FVector FeetLocation = GetGravityFeetLocation();
+	FVector ToTarget = FDGMath::HorizontalComponent(SurfacePath.Points[SurfacePathIndex] - FeetLocation, VerticalDirection);
+
+	// Skip the points already reached.
+	while (ToTarget.SizeSquared() <= FMath::Square(SurfacePathAcceptanceRadius))
+	{
+		if (++SurfacePathIndex >= SurfacePath.Points.Num())
+		{
+			StopMovingAlongSurface();
+			return;
+		}
+		ToTarget = FDGMath::HorizontalComponent(SurfacePath.Points[SurfacePathIndex] - FeetLocation, VerticalDirection);
+	}
+
+	if (bSurfacePathGravitySaved)
+	{
+		// Only the path gravity, without the world gravity added to it. @see GetIgnoreWorldGravityIfDynamicGravityIsNotZero
+		DynamicGravity = -SurfacePath.Ups[SurfacePathIndex] * SurfacePathGravityMagnitude;
+	}
+
+	RequestPathMove(ToTarget.GetSafeNormal());
+}
+
 FVector UDGCharacterMovementComponent::GetLedgeMove(const FVector& OldLocation, const FVector& Delta, const FVector& GravDir) const
 {
 	if (!HasValidData() || Delta.IsZero())
@@ -607,10 +1034,10 @@ FVector UDGCharacterMovementComponent::GetLedgeMove(const FVector& OldLocation,
 	}
 
 	FVector SideDir(Delta.Y, -1.f * Delta.X, 0.f);
-	FVector SideDirProjectedOnGravDir = SideDir.ProjectOnToNormal(GravDir);
+	const FVector SideDirProjectedOnGravDir = FDGMath::VerticalComponent(SideDir, GravDir);
 	if (!SideDirProjectedOnGravDir.IsZero())
 	{
-		SideDir = (SideDir - SideDirProjectedOnGravDir).GetSafeNormal() * SideDir.Size();
+		SideDir = FDGMath::HorizontalDirection(SideDir, GravDir) * SideDir.Size();
 	}
 
 	// try left
@@ -723,6 +1150,55 @@ void UDGCharacterMovementComponent::ApplyRootMotionToVelocity(float deltaTime)
 	}
 }
 
+FVector UDGCharacterMovementComponent::ConstrainAnimRootMotionVelocity(const FVector& RootMotionVelocity, const FVector& CurrentVelocity) const
+{
+	// Do not override the vertical velocity if in falling physics, we want to keep the effect of gravity.
+	if (IsFalling())
+	{
+		return FDGMath::HorizontalComponent(RootMotionVelocity, VerticalDirection) + FDGMath::VerticalComponent(CurrentVelocity, VerticalDirection);
+	}
+
+	return RootMotionVelocity;
+}
+
+int32 UDGCharacterMovementComponent::ApplyGravityJumpForce(FName InstanceName, FVector Direction, float Distance, float Height, float Duration, bool bFinishOnLanded)
+{
+	TSharedPtr<FDGRootMotionSource_GravityJumpForce> JumpForce = MakeShared<FDGRootMotionSource_GravityJumpForce>();
+	JumpForce->InstanceName = InstanceName;
+	JumpForce->AccumulateMode = ERootMotionAccumulateMode::Override;
+	JumpForce->Priority = 500;
+	JumpForce->Duration = FMath::Max(Duration, SMALL_NUMBER);
+	JumpForce->Rotation = FDGMath::HorizontalDirection(Direction, VerticalDirection).Rotation();
+	JumpForce->Distance = Distance;
+	JumpForce->Height = Height;
+	JumpForce->bDisableTimeout = bFinishOnLanded;
+	JumpForce->MinimumLandedTriggerTime = bFinishOnLanded ? JumpForce->Duration * 0.5f : 0.f;
+	JumpForce->UpVector = VerticalDirection;
+
+	return ApplyRootMotionSource(JumpForce);
+}
+
+void UDGCharacterMovementComponent::EndGravityJumpForcesOnLanded()
+{
+	TArray<uint16, TInlineAllocator<4>> FinishedIDs;
+	for (const TSharedPtr<FRootMotionSource>& RootMotionSource : CurrentRootMotion.RootMotionSources)
+	{
+		if (RootMotionSource.IsValid() && RootMotionSource->GetScriptStruct() == FDGRootMotionSource_GravityJumpForce::StaticStruct())
+		{
+			const FDGRootMotionSource_GravityJumpForce* JumpForce = static_cast<const FDGRootMotionSource_GravityJumpForce*>(RootMotionSource.Get());
+			if (JumpForce->bDisableTimeout && JumpForce->GetTime() >= JumpForce->MinimumLandedTriggerTime)
+			{
+				FinishedIDs.Add(JumpForce->LocalID);
+			}
+		}
+	}
+
+	for (const uint16 ID : FinishedIDs)
+	{
+		RemoveRootMotionSourceByID(ID);
+	}
+}
+
 void UDGCharacterMovementComponent::SetDefaultMovementMode()
 {
 	// check for water volume
@@ -807,6 +1283,14 @@ void UDGCharacterMovementComponent::MoveSmooth(const FVector& InVelocity, const
 	}
 }
 
+void UDGCharacterMovementComponent::PerformMovement(float DeltaTime)
+{
+	// The surface path changes the gravity after TickComponent refreshed the frame, and server and replayed moves don't go through TickComponent.
+	UpdateGravityFrame();
+
+	Super::PerformMovement(DeltaTime);
+}
+
 void UDGCharacterMovementComponent::SimulateMovement(float DeltaSeconds)
 {
 	if (!HasValidData() || UpdatedComponent->Mobility != EComponentMobility::Movable || UpdatedComponent->IsSimulatingPhysics())
@@ -814,6 +1298,9 @@ void UDGCharacterMovementComponent::SimulateMovement(float DeltaSeconds)
 		return;
 	}
 
+	// The surface path may have changed the gravity since TickComponent refreshed the frame.
+	UpdateGravityFrame();
+
 	const bool bIsSimulatedProxy = (CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy);
 
 	const FRepMovement& ConstRepMovement = CharacterOwner->GetReplicatedMovement();
@@ -1029,7 +1516,7 @@ void UDGCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iteration
 		UPrimitiveComponent* const OldBase = GetMovementBase();
 		const FVector PreviousBaseLocation = (OldBase != NULL) ? OldBase->GetComponentLocation() : FVector::ZeroVector;
 		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
-		const FFindFloorResult OldFloor = CurrentFloor;
+		const FDGFloorSnapshot OldFloor(CurrentFloor);
 
 		RestorePreAdditiveRootMotionVelocity();
 
@@ -1048,7 +1535,6 @@ void UDGCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iteration
 
 		if (IsFalling())
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, TEXT("test"));
 			// Root motion could have put us into Falling.
 			// No movement has taken place this movement tick so we pass on full time/past iteration count
 			StartNewPhysics(remainingTime + timeTick, Iterations - 1);
@@ -1143,7 +1629,7 @@ void UDGCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iteration
 			{
 				if (ShouldCatchAir(OldFloor, CurrentFloor))
 				{
-					HandleWalkingOffLedge(OldFloor.HitResult.ImpactNormal, OldFloor.HitResult.Normal, OldLocation, timeTick);
+					HandleWalkingOffLedge(OldFloor.ImpactNormal, OldFloor.Normal, OldLocation, timeTick);
 					if (IsMovingOnGround())
 					{
 						// If still walking, then fall. If not, assume the user set a different mode they want to keep.
@@ -1212,84 +1698,267 @@ void UDGCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iteration
 	}
 }
 
-FVector UDGCharacterMovementComponent::ComputeGroundMovementDelta(const FVector& Delta, const FHitResult& RampHit, const bool bHitFromLineTrace) const
+bool UDGCharacterMovementComponent::ShouldCatchAir(const FDGFloorSnapshot& OldFloor, const FFindFloorResult& NewFloor)
 {
-	const FVector FloorNormal = RampHit.ImpactNormal;
-	const FVector ContactNormal = RampHit.Normal;
-	const float FloorNormalZ = FVector::DotProduct(FloorNormal, VerticalDirection);
-	const float ContactNormalZ = FVector::DotProduct(ContactNormal, VerticalDirection);
+	return bUseFullOldFloor && ShouldCatchAir(OldFloor.ToFloorResult(), NewFloor);
+}
 
-	if (FloorNormalZ < (1.f - KINDA_SMALL_NUMBER) && FloorNormalZ > KINDA_SMALL_NUMBER && ContactNormalZ > KINDA_SMALL_NUMBER && !bHitFromLineTrace && IsWalkable(RampHit))
+bool UDGCharacterMovementComponent::CheckFall(const FDGFloorSnapshot& OldFloor, const FHitResult& Hit, const FVector& Delta, const FVector& OldLocation, float remainingTime, float timeTick, int32 Iterations, bool bMustJump)
+{
+	if (bUseFullOldFloor)
 	{
-		// Compute a vector that moves parallel to the surface, by projecting the horizontal movement direction onto the ramp.
-		const float FloorDotDelta = (FloorNormal | Delta);
-		const FVector DeltaProjectedOnToFloorDirection = Delta.ProjectOnToNormal(VerticalDirection);
-		FVector RampMovement = Delta - Delta.ProjectOnToNormal(VerticalDirection) + DeltaProjectedOnToFloorDirection.GetSafeNormal() * (-FloorDotDelta / FloorNormalZ);  //RampMovement(Delta.X, Delta.Y, -FloorDotDelta / FloorNormalZ);
-
-		if (bMaintainHorizontalGroundVelocity)
-		{
-			return RampMovement;
-		}
-		else
-		{
-			return RampMovement.GetSafeNormal() * Delta.Size();
-		}
+		return CheckFall(OldFloor.ToFloorResult(), Hit, Delta, OldLocation, remainingTime, timeTick, Iterations, bMustJump);
 	}
 
-	return Delta;
-}
-
-float UDGCharacterMovementComponent::SlideAlongSurface(const FVector& Delta, float Time, const FVector& InNormal, FHitResult& Hit, bool bHandleImpact)
-{
-	if (!Hit.bBlockingHit)
+	if (!HasValidData())
 	{
-		return 0.f;
+		return false;
 	}
 
-	FVector Normal(InNormal);
-	if (IsMovingOnGround())
+	if (bMustJump || CanWalkOffLedges())
 	{
-		// We don't want to be pushed up an unwalkable surface.
-		float NormalVertical = FVector::DotProduct(Normal, VerticalDirection);
-		if (NormalVertical > 0.f)
-		{
-			if (!IsWalkable(Hit))
-			{
-				Normal -= Normal.ProjectOnToNormal(VerticalDirection);
-			}
-		}
-		else if (NormalVertical < -KINDA_SMALL_NUMBER)
+		HandleWalkingOffLedge(OldFloor.ImpactNormal, OldFloor.Normal, OldLocation, timeTick);
+		if (IsMovingOnGround())
 		{
-			// Don't push down into the floor when the impact is on the upper portion of the capsule.
-			if (CurrentFloor.FloorDist < MIN_FLOOR_DIST && CurrentFloor.bBlockingHit)
-			{
-				const FVector FloorNormal = CurrentFloor.HitResult.Normal;
-				const bool bFloorOpposedToMovement = (Delta | FloorNormal) < 0.f && (FVector::DotProduct(FloorNormal, VerticalDirection) < 1.f - DELTA);
-				if (bFloorOpposedToMovement)
-				{
-					// Doubt if should be positive or negative.
-					Normal = -FloorNormal;
-				}
-
-				Normal += Normal.ProjectOnToNormal(VerticalDirection);
-			}
+			// If still walking, then fall. If not, assume the user set a different mode they want to keep.
+			StartFalling(Iterations, remainingTime, timeTick, Delta, OldLocation);
 		}
+		return true;
 	}
 
-	return UMovementComponent::SlideAlongSurface(Delta, Time, Normal, Hit, bHandleImpact);
+	return false;
 }
 
-void UDGCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity, float DeltaSeconds, FStepDownResult* OutStepDownResult)
+void UDGCharacterMovementComponent::RevertMove(const FVector& OldLocation, UPrimitiveComponent* OldBase, const FVector& PreviousBaseLocation, const FDGFloorSnapshot& OldFloor, bool bFailMove)
 {
-	if (!CurrentFloor.IsWalkableFloor())
+	UpdatedComponent->SetWorldLocation(OldLocation, false, NULL, GetTeleportType());
+	bJustTeleported = false;
+
+	// If the old base couldn't have moved or changed in any physics-affecting way, restore it.
+	if (IsValid(OldBase) && (!MovementBaseUtility::IsDynamicBase(OldBase) || OldBase->Mobility == EComponentMobility::Static || OldBase->GetComponentLocation() == PreviousBaseLocation))
 	{
-		return;
+		CurrentFloor = OldFloor.ToFloorResult();
+		SetBase(OldBase, OldFloor.BoneName);
+	}
+	else
+	{
+		SetBase(NULL);
 	}
 
-	// Move along the current floor
-
-	const FVector Delta = (InVelocity - InVelocity.ProjectOnToNormal(VerticalDirection)) * DeltaSeconds;
-	FHitResult Hit(1.f);
+	if (bFailMove)
+	{
+		// End movement now.
+		Velocity = FVector::ZeroVector;
+		Acceleration = FVector::ZeroVector;
+		CharacterOwner->CheckStillInWorld();
+	}
+}
+
+void UDGCharacterMovementComponent::PhysNavWalking(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharPhysNavWalking);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	if ((!CharacterOwner || !CharacterOwner->Controller) && !bRunPhysicsWithNoController && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Acceleration = FVector::ZeroVector;
+		Velocity = FVector::ZeroVector;
+		return;
+	}
+
+	RestorePreAdditiveRootMotionVelocity();
+
+	// Ensure velocity is horizontal.
+	MaintainHorizontalGroundVelocity();
+	devCode(ensureMsgf(!Velocity.ContainsNaN(), TEXT("PhysNavWalking: Velocity contains NaN before CalcVelocity (%s)\n%s"), *GetPathNameSafe(this), *Velocity.ToString()));
+
+	// Bound acceleration.
+	Acceleration = FDGMath::HorizontalComponent(Acceleration, VerticalDirection);
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		CalcVelocity(deltaTime, GroundFriction, false, GetMaxBrakingDeceleration());
+	}
+
+	ApplyRootMotionToVelocity(deltaTime);
+
+	if (IsFalling())
+	{
+		// Root motion could have put us into Falling.
+		StartNewPhysics(deltaTime, Iterations);
+		return;
+	}
+
+	Iterations++;
+
+	const FVector DeltaMove = FDGMath::HorizontalComponent(Velocity, VerticalDirection) * deltaTime;
+	const FVector OldFeetLocation = GetGravityFeetLocation();
+	const FVector DesiredFeetLocation = OldFeetLocation + DeltaMove;
+
+	// Refresh the surface when it's old, when the character left the sampled area or when the vertical direction changed.
+	NavWalkingSurfaceAge += deltaTime;
+	const float PawnRadius = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleRadius();
+	const bool bRefreshSurface = !bNavWalkingSurfaceValid
+		|| NavWalkingSurfaceAge >= NavMeshProjectionInterval
+		|| FDGMath::HorizontalComponent(DesiredFeetLocation - NavWalkingSurfacePoint, NavWalkingSurfaceVerticalDirection).SizeSquared() > FMath::Square(PawnRadius)
+		|| (NavWalkingSurfaceVerticalDirection | VerticalDirection) < THRESH_NORMALS_ARE_PARALLEL;
+
+	if (bRefreshSurface && !RefreshNavWalkingSurface(DesiredFeetLocation))
+	{
+		// Nothing moved yet, so StartFalling hands the whole deltaTime to the falling physics.
+		StartFalling(Iterations, 0.f, deltaTime, DeltaMove, UpdatedComponent->GetComponentLocation());
+		return;
+	}
+
+	// Distance along the vertical direction from the desired location to the surface plane.
+	const float NormalDotVertical = NavWalkingSurfaceNormal | VerticalDirection;
+	const float HeightAboveSurface = NormalDotVertical > KINDA_SMALL_NUMBER ? ((DesiredFeetLocation - NavWalkingSurfacePoint) | NavWalkingSurfaceNormal) / NormalDotVertical : 0.f;
+
+	float HeightOffset = -HeightAboveSurface;
+	if (bProjectNavMeshWalking && NavMeshProjectionInterpSpeed > 0.f)
+	{
+		HeightOffset = FMath::FInterpTo(0.f, HeightOffset, deltaTime, NavMeshProjectionInterpSpeed);
+	}
+
+	const FVector AdjustedDelta = DeltaMove + VerticalDirection * HeightOffset;
+	if (!AdjustedDelta.IsNearlyZero())
+	{
+		FHitResult HitResult;
+		SafeMoveUpdatedComponent(AdjustedDelta, UpdatedComponent->GetComponentQuat(), bSweepWhileNavWalking, HitResult);
+	}
+
+	// Update velocity to reflect actual move
+	if (!bJustTeleported && !HasAnimRootMotion() && !CurrentRootMotion.HasVelocity())
+	{
+		Velocity = (GetGravityFeetLocation() - OldFeetLocation) / deltaTime;
+		MaintainHorizontalGroundVelocity();
+	}
+
+	bJustTeleported = false;
+}
+
+bool UDGCharacterMovementComponent::RefreshNavWalkingSurface(const FVector& FeetLocation)
+{
+	NavWalkingSurfaceAge = 0.f;
+	NavWalkingSurfaceVerticalDirection = VerticalDirection;
+	bNavWalkingSurfaceValid = false;
+
+	const float TotalCapsuleHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() * 2.0f;
+	const FVector TraceStart = FeetLocation + VerticalDirection * (TotalCapsuleHeight * FMath::Max(0.f, NavMeshProjectionHeightScaleUp));
+	const FVector TraceEnd = FeetLocation - VerticalDirection * (TotalCapsuleHeight * FMath::Max(0.f, NavMeshProjectionHeightScaleDown) + MAX_FLOOR_DIST);
+
+	// Nav walking physics ignores the world on the capsule, so the responses of the capsule can't be used here.
+	FCollisionResponseParams ResponseParams(ECR_Ignore);
+	ResponseParams.CollisionResponse.SetResponse(ECC_WorldStatic, ECR_Block);
+	ResponseParams.CollisionResponse.SetResponse(ECC_WorldDynamic, ECR_Block);
+
+	FHitResult Hit;
+	const bool bBlockingHit = GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, UpdatedComponent->GetCollisionObjectType(), GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(DGNavWalkingSurface)), ResponseParams);
+	if (!bBlockingHit || Hit.bStartPenetrating || !IsWalkable(Hit))
+	{
+		return false;
+	}
+
+	NavWalkingSurfacePoint = Hit.ImpactPoint;
+	NavWalkingSurfaceNormal = Hit.ImpactNormal;
+	bNavWalkingSurfaceValid = true;
+	return true;
+}
+
+FVector UDGCharacterMovementComponent::GetGravityFeetLocation() const
+{
+	if (UpdatedComponent == NULL)
+	{
+		return FNavigationSystem::InvalidLocation;
+	}
+
+	const float HalfHeight = (CharacterOwner != NULL) ? CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() : UpdatedComponent->Bounds.BoxExtent.Z;
+	return UpdatedComponent->GetComponentLocation() - VerticalDirection * HalfHeight;
+}
+
+FVector UDGCharacterMovementComponent::ComputeGroundMovementDelta(const FVector& Delta, const FHitResult& RampHit, const bool bHitFromLineTrace) const
+{
+	const FVector FloorNormal = RampHit.ImpactNormal;
+	const FVector ContactNormal = RampHit.Normal;
+	const float FloorNormalZ = FVector::DotProduct(FloorNormal, VerticalDirection);
+	const float ContactNormalZ = FVector::DotProduct(ContactNormal, VerticalDirection);
+
+	if (FloorNormalZ < (1.f - KINDA_SMALL_NUMBER) && FloorNormalZ > KINDA_SMALL_NUMBER && ContactNormalZ > KINDA_SMALL_NUMBER && !bHitFromLineTrace && IsWalkable(RampHit))
+	{
+		// Compute a vector that moves parallel to the surface, by projecting the horizontal movement direction onto the ramp.
+		const float FloorDotDelta = (FloorNormal | Delta);
+		FVector DeltaProjectedOnToFloorDirection, DeltaHorizontal;
+		FDGMath::Decompose(Delta, VerticalDirection, DeltaProjectedOnToFloorDirection, DeltaHorizontal);
+		FVector RampMovement = DeltaHorizontal + DeltaProjectedOnToFloorDirection.GetSafeNormal() * (-FloorDotDelta / FloorNormalZ);  //RampMovement(Delta.X, Delta.Y, -FloorDotDelta / FloorNormalZ);
+
+		if (bMaintainHorizontalGroundVelocity)
+		{
+			return RampMovement;
+		}
+		else
+		{
+			return RampMovement.GetSafeNormal() * Delta.Size();
+		}
+	}
+
+	return Delta;
+}
+
+float UDGCharacterMovementComponent::SlideAlongSurface(const FVector& Delta, float Time, const FVector& InNormal, FHitResult& Hit, bool bHandleImpact)
+{
+	if (!Hit.bBlockingHit)
+	{
+		return 0.f;
+	}
+
+	FVector Normal(InNormal);
+	if (IsMovingOnGround())
+	{
+		// We don't want to be pushed up an unwalkable surface.
+		float NormalVertical = FVector::DotProduct(Normal, VerticalDirection);
+		if (NormalVertical > 0.f)
+		{
+			if (!IsWalkable(Hit))
+			{
+				Normal -= Normal.ProjectOnToNormal(VerticalDirection);
+			}
+		}
+		else if (NormalVertical < -KINDA_SMALL_NUMBER)
+		{
+			// Don't push down into the floor when the impact is on the upper portion of the capsule.
+			if (CurrentFloor.FloorDist < MIN_FLOOR_DIST && CurrentFloor.bBlockingHit)
+			{
+				const FVector FloorNormal = CurrentFloor.HitResult.Normal;
+				const bool bFloorOpposedToMovement = (Delta | FloorNormal) < 0.f && (FVector::DotProduct(FloorNormal, VerticalDirection) < 1.f - DELTA);
+				if (bFloorOpposedToMovement)
+				{
+					// Doubt if should be positive or negative.
+					Normal = -FloorNormal;
+				}
+
+				Normal += Normal.ProjectOnToNormal(VerticalDirection);
+			}
+		}
+	}
+
+	return UMovementComponent::SlideAlongSurface(Delta, Time, Normal, Hit, bHandleImpact);
+}
+
+void UDGCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity, float DeltaSeconds, FStepDownResult* OutStepDownResult)
+{
+	if (!CurrentFloor.IsWalkableFloor())
+	{
+		return;
+	}
+
+	// Move along the current floor
+
+	const FVector Delta = (InVelocity - InVelocity.ProjectOnToNormal(VerticalDirection)) * DeltaSeconds;
+	FHitResult Hit(1.f);
 	FVector RampVector = ComputeGroundMovementDelta(Delta, CurrentFloor.HitResult, CurrentFloor.bLineTrace);
 	SafeMoveUpdatedComponent(RampVector, UpdatedComponent->GetComponentQuat(), true, Hit);
 	float LastMoveTimeSlice = DeltaSeconds;
@@ -1348,25 +2017,35 @@ void UDGCharacterMovementComponent::MoveAlongFloor(const FVector& InVelocity, fl
 
 void UDGCharacterMovementComponent::MaintainHorizontalGroundVelocity()
 {
-	FVector VerticalVelocity = Velocity.ProjectOnToNormal(VerticalDirection);
+	FVector VerticalVelocity, HorizontalVelocity;
+	FDGMath::Decompose(Velocity, VerticalDirection, VerticalVelocity, HorizontalVelocity);
 
 	if (!VerticalVelocity.IsNearlyZero())
 	{
 		if (bMaintainHorizontalGroundVelocity)
 		{
 			// Ramp movement already maintained the velocity, so we just want to remove the vertical component.
-			Velocity -= VerticalVelocity;
+			Velocity = HorizontalVelocity;
 		}
 		else
 		{
 			// Rescale velocity to be horizontal but maintain magnitude of last update.
-			float ScalarVelocity = Velocity.Size();
-			Velocity -= VerticalVelocity;
-			Velocity = Velocity.GetSafeNormal() * ScalarVelocity;
+			const float ScalarVelocity = Velocity.Size();
+			Velocity = HorizontalVelocity.GetSafeNormal() * ScalarVelocity;
 		}
 	}
 }
 
+void UDGCharacterMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+
+	if (AvoidanceSubsystem != NULL && IsMovingOnGround() && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Velocity = AvoidanceSubsystem->ComputeAvoidanceVelocity(this, Velocity, DeltaTime);
+	}
+}
+
 void UDGCharacterMovementComponent::Crouch(bool bClientSimulation)
 {
 	if (!HasValidData())
@@ -1414,9 +2093,8 @@ void UDGCharacterMovementComponent::Crouch(bool bClientSimulation)
 		// Crouching to a larger height? (this is rare)
 		if (ClampedCrouchedHalfHeight > OldUnscaledHalfHeight)
 		{
-			FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(CrouchTrace), false, CharacterOwner);
-			FCollisionResponseParams ResponseParam;
-			InitCollisionParams(CapsuleParams, ResponseParam);
+			const FCollisionQueryParams& CapsuleParams = GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(CrouchTrace));
+			const FCollisionResponseParams& ResponseParam = CachedCollisionResponseParams;
 			const bool bEncroached = GetWorld()->OverlapBlockingTestByChannel(UpdatedComponent->GetComponentLocation() + PawnDownDirection * ScaledHalfHeightAdjust, FQuat::Identity,
 				UpdatedComponent->GetCollisionObjectType(), GetPawnCapsuleCollisionShape(SHRINK_None), CapsuleParams, ResponseParam);
 
@@ -1496,9 +2174,8 @@ void UDGCharacterMovementComponent::UnCrouch(bool bClientSimulation)
 		// Try to stay in place and see if the larger capsule fits. We use a slightly taller capsule to avoid penetration.
 		const UWorld* MyWorld = GetWorld();
 		const float SweepInflation = KINDA_SMALL_NUMBER * 10.f;
-		FCollisionQueryParams CapsuleParams(SCENE_QUERY_STAT(CrouchTrace), false, CharacterOwner);
-		FCollisionResponseParams ResponseParam;
-		InitCollisionParams(CapsuleParams, ResponseParam);
+		const FCollisionQueryParams& CapsuleParams = GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(CrouchTrace));
+		const FCollisionResponseParams& ResponseParam = CachedCollisionResponseParams;
 
 		// Compensate for the difference between current capsule size and standing size
 		const FQuat Quat = CharacterOwner->GetActorQuat();
@@ -1621,8 +2298,24 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 	}
 
 
+	if (ShouldStartOrbiting())
+	{
+		SetMovementMode(MOVE_Custom, (uint8)EDGCustomMovementMode::CMOVE_Orbital);
+		StartNewPhysics(DeltaTime, Iterations + 1);
+		return;
+	}
+
+	if (bAdaptiveFallingSubsteps)
+	{
+		UpdateAdaptiveFallingTimeStep(DeltaTime);
+	}
+	else if (bSkipFallSweepsInClearance)
+	{
+		EstimateFallClearance();
+	}
+
 	FVector FallAcceleration = GetFallingLateralAcceleration(DeltaTime);
-	FallAcceleration -= FallAcceleration.ProjectOnTo(Gravity());
+	FallAcceleration = FDGMath::HorizontalComponent(FallAcceleration, GravityNormal());
 	const bool bHasAirControl = (FallAcceleration.SizeSquared() > 0.f);
 
 	float remainingTime = DeltaTime;
@@ -1631,6 +2324,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 		Iterations++;
 		const float timeTick = GetSimulationTimeStep(remainingTime, Iterations);
 		remainingTime -= timeTick;
+		INC_DWORD_STAT(STAT_DGFallingSubsteps);
 
 		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
 		const FQuat PawnRotation = UpdatedComponent->GetComponentQuat();
@@ -1641,7 +2335,9 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 		FVector OldVelocity = Velocity;
 		FVector VelocityNoAirControl = Velocity;
 
-		FVector Grav = Gravity();
+		const FVector Grav = Gravity();
+		const FVector GravDir = Grav.GetSafeNormal();
+		const FVector OldVerticalVelocity = FDGMath::VerticalComponent(OldVelocity, GravDir);
 		// Apply input
 		if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
 		{
@@ -1652,18 +2348,18 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 				// Find velocity *without* acceleration.
 				TGuardValue<FVector> RestoreAcceleration(Acceleration, FVector::ZeroVector);
 				TGuardValue<FVector> RestoreVelocity(Velocity, Velocity);
-				Velocity -= Velocity.ProjectOnTo(Grav);
+				Velocity = FDGMath::HorizontalComponent(Velocity, GravDir);
 				CalcVelocity(timeTick, FallingLateralFriction, false, MaxDecel);
-				VelocityNoAirControl = Velocity - Velocity.ProjectOnTo(Grav) + OldVelocity.ProjectOnTo(Grav);
+				VelocityNoAirControl = FDGMath::HorizontalComponent(Velocity, GravDir) + OldVerticalVelocity;
 			}
 
 			// Compute Velocity
 			{
 				// Acceleration = FallAcceleration for CalcVelocity(), but we restore it after using it.
 				TGuardValue<FVector> RestoreAcceleration(Acceleration, FallAcceleration);
-				Velocity -= Velocity.ProjectOnTo(Grav);
+				Velocity = FDGMath::HorizontalComponent(Velocity, GravDir);
 				CalcVelocity(timeTick, FallingLateralFriction, false, MaxDecel);
-				Velocity += OldVelocity.ProjectOnTo(Grav);
+				Velocity += OldVerticalVelocity;
 			}
 
 			// Just copy Velocity to VelocityNoAirControl if they are the same (ie no acceleration).
@@ -1697,7 +2393,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 
 		ApplyRootMotionToVelocity(timeTick);
 
-		if (bNotifyApex && (Velocity.ProjectOnTo(Grav).Size() <= 0.f))
+		if (bNotifyApex && (FDGMath::VerticalComponent(Velocity, GravDir).Size() <= 0.f))
 		{
 			// Just passed jump apex since now going down
 			bNotifyApex = false;
@@ -1708,7 +2404,17 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 		// Move
 		FHitResult Hit(1.f);
 		FVector Adjusted = 0.5f * (OldVelocity + Velocity) * timeTick;
-		SafeMoveUpdatedComponent(Adjusted, PawnRotation, true, Hit);
+		if (bSkipFallSweepsInClearance && Adjusted.SizeSquared() < FMath::Square(GetCachedFallClearance(OldLocation)))
+		{
+			// Nothing to hit within the clearance.
+			INC_DWORD_STAT(STAT_DGFallingUnsweptMoves);
+			MoveUpdatedComponent(Adjusted, PawnRotation, false);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_DGFallingSweeps);
+			SafeMoveUpdatedComponent(Adjusted, PawnRotation, true, Hit);
+		}
 
 		if (!HasValidData())
 		{
@@ -1777,12 +2483,13 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
 				{
 					const FVector NewVelocity = (Delta / subTimeTickRemaining);
-					Velocity = HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() ? Velocity + (NewVelocity - Velocity).ProjectOnTo(Grav) : NewVelocity;
+					Velocity = HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() ? Velocity + FDGMath::VerticalComponent(NewVelocity - Velocity, GravDir) : NewVelocity;
 				}
 
 				if (subTimeTickRemaining > KINDA_SMALL_NUMBER && (Delta | Adjusted) > 0.f)
 				{
 					// Move in deflected direction.
+					INC_DWORD_STAT(STAT_DGFallingSweeps);
 					SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
 
 					if (Hit.bBlockingHit)
@@ -1806,7 +2513,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 							return;
 						}
 
-						const FVector OpositeAttractionImpulseNormal = -Grav.GetSafeNormal();
+						const FVector OpositeAttractionImpulseNormal = -GravDir;
 						// Act as if there was no air control on the last move when computing new deflection.
 						if (bHasAirControl && FVector::DotProduct(Hit.Normal, OpositeAttractionImpulseNormal) > VERTICAL_SLOPE_NORMAL_Z)
 						{
@@ -1834,11 +2541,12 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 						if (subTimeTickRemaining > KINDA_SMALL_NUMBER && !bJustTeleported)
 						{
 							const FVector NewVelocity = (Delta / subTimeTickRemaining);
-							Velocity = HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() ? Velocity + (NewVelocity - Velocity).ProjectOnTo(Grav) : NewVelocity;
+							Velocity = HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() ? Velocity + FDGMath::VerticalComponent(NewVelocity - Velocity, GravDir) : NewVelocity;
 						}
 
 						// bDitch=true means that pawn is straddling two slopes, neither of which he can stand on
 						bool bDitch = ((FVector::DotProduct(OldHitImpactNormal, OpositeAttractionImpulseNormal) > 0.f) && (FVector::DotProduct(Hit.ImpactNormal, OpositeAttractionImpulseNormal) > 0.f) && (Delta.ProjectOnToNormal(OpositeAttractionImpulseNormal).Size() <= KINDA_SMALL_NUMBER) && ((Hit.ImpactNormal | OldHitImpactNormal) < 0.f));
+						INC_DWORD_STAT(STAT_DGFallingSweeps);
 						SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
 						if (Hit.Time == 0.f)
 						{
@@ -1848,6 +2556,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 							{
 								SideDelta = FVector(OldHitNormal.Y, -OldHitNormal.X, 0).GetSafeNormal();
 							}
+							INC_DWORD_STAT(STAT_DGFallingSweeps);
 							SafeMoveUpdatedComponent(SideDelta, PawnRotation, true, Hit);
 						}
 
@@ -1861,7 +2570,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 						{
 							// We might be in a virtual 'ditch' within our perch radius. This is rare.
 							const FVector PawnLocation = UpdatedComponent->GetComponentLocation();
-							const float ZMovedDist = (PawnLocation - OldLocation).ProjectOnToNormal(OpositeAttractionImpulseNormal).Size();
+							const float ZMovedDist = FDGMath::VerticalComponent(PawnLocation - OldLocation, OpositeAttractionImpulseNormal).Size();
 							const float MovedDistSq = (PawnLocation - OldLocation).SizeSquared();
 							if (ZMovedDist <= 0.2f * timeTick && MovedDistSq <= 4.f * timeTick)
 							{
@@ -1871,6 +2580,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 								Velocity += Velocity.ProjectOnToNormal(OpositeAttractionImpulseNormal) - OpositeAttractionImpulseNormal * FMath::Max<float>(JumpZVelocity * 0.25f, 1.f);
 
 								Delta = Velocity * timeTick;
+								INC_DWORD_STAT(STAT_DGFallingSweeps);
 								SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
 							}
 						}
@@ -1879,7 +2589,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 			}
 		}
 
-		FVector HorizontalVelocity = Velocity - Velocity.ProjectOnTo(Grav);
+		const FVector HorizontalVelocity = FDGMath::HorizontalComponent(Velocity, GravDir);
 		if (HorizontalVelocity.SizeSquared() <= KINDA_SMALL_NUMBER * 10.f)
 		{
 			Velocity -= HorizontalVelocity;
@@ -1890,7 +2600,7 @@ void UDGCharacterMovementComponent::PhysFalling(float DeltaTime, int32 Iteration
 FVector UDGCharacterMovementComponent::GetFallingLateralAcceleration(float DeltaTime)
 {
 	// No acceleration in Z
-	FVector FallAcceleration = Acceleration - Acceleration.ProjectOnTo(Gravity());
+	FVector FallAcceleration = FDGMath::HorizontalComponent(Acceleration, GravityNormal());
 
 	// bound acceleration, falling object has minimal ability to impact acceleration
 	if (!HasAnimRootMotion() && FallAcceleration.SizeSquared() > 0.f)
@@ -1953,122 +2663,734 @@ float UDGCharacterMovementComponent::BoostAirControl(float DeltaTime, float Tick
 	return TickAirControl;
 }
 
-void UDGCharacterMovementComponent::FindFloor(const FVector WalkableFloorNormal, const FRotator Rot, FVector CapsuleLocation, FFindFloorResult& FloorResult) const
+float UDGCharacterMovementComponent::EstimateFallClearance()
 {
-	const bool SavedForceNextFloorCheck(bForceNextFloorCheck);
-	FindFloor(WalkableFloorNormal, Rot, CapsuleLocation, FloorResult, false);
+	const FVector CapsuleLocation = UpdatedComponent->GetComponentLocation();
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
 
-	// FindFloor clears this, but this is only a test not done during normal movement.
-	UDGCharacterMovementComponent* MutableThis = const_cast<UDGCharacterMovementComponent*>(this);
-	MutableThis->bForceNextFloorCheck = SavedForceNextFloorCheck;
-}
+	// Probe again near the border of the sphere, or when it may be stale.
+	if (bFallClearanceValid && FVector::DistSquared(CapsuleLocation, FallClearanceCenter) <= FMath::Square(FallClearanceProbeRadius * 0.5f) && TimeSeconds - FallClearanceProbeTime <= FallClearanceMaxAge)
+	{
+		return GetCachedFallClearance(CapsuleLocation);
+	}
 
+	INC_DWORD_STAT(STAT_DGFallClearanceProbes);
 
-void UDGCharacterMovementComponent::ComputeFloorDist(const FVector WalkableFloorNormal, const FRotator Rot, FVector CapsuleLocation, float LineDistance, float SweepDistance, float SweepRadius, FFindFloorResult& FloorResult) const
+	// The probe sphere encloses the capsule, so no overlap means nothing within FallClearanceProbeRadius of it.
+	const float CapsuleHalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FCollisionShape ProbeShape = FCollisionShape::MakeSphere(CapsuleHalfHeight + FallClearanceProbeRadius);
+	const FCollisionQueryParams& QueryParams = GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(FallClearance));
+	const bool bOverlap = GetWorld()->OverlapAnyTestByChannel(CapsuleLocation, FQuat::Identity, UpdatedComponent->GetCollisionObjectType(), ProbeShape, QueryParams, CachedCollisionResponseParams);
+
+	FallClearanceCenter = CapsuleLocation;
+	FallClearanceRadius = bOverlap ? 0.f : ProbeShape.GetSphereRadius();
+	FallClearanceProbeTime = TimeSeconds;
+	bFallClearanceValid = true;
+
+	return GetCachedFallClearance(CapsuleLocation);
+}
+
+float UDGCharacterMovementComponent::GetCachedFallClearance(const FVector& CapsuleLocation) const
 {
-	if (HasValidData())
+	if (!bFallClearanceValid || FallClearanceRadius <= 0.f)
 	{
-		SweepDistance = FMath::Max(SweepDistance, 0.f);
-		LineDistance = FMath::Clamp(LineDistance, 0.f, SweepDistance);
-		SweepRadius = FMath::Max(SweepRadius, 0.f);
-
-		ComputeFloorDist(WalkableFloorNormal, Rot, CapsuleLocation, LineDistance, SweepDistance, FloorResult, SweepRadius);
+		return 0.f;
 	}
+
+	const float CapsuleHalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	return FMath::Max(0.f, FallClearanceRadius - FVector::Dist(CapsuleLocation, FallClearanceCenter) - CapsuleHalfHeight);
 }
 
-bool UDGCharacterMovementComponent::IsValidLandingSpot(const FVector& CapsuleLocation, const FHitResult& Hit) const
+void UDGCharacterMovementComponent::UpdateAdaptiveFallingTimeStep(float DeltaTime)
 {
-	FVector WalkableFloorNormal = this->WalkableFloorNormal();
+	const FVector Grav = Gravity();
+	const FVector GravDir = Grav.GetSafeNormal();
+	const float Speed = Velocity.Size();
 
-	if (!Hit.bBlockingHit)
+	// Turn rate of the path, from the gravity perpendicular to the velocity.
+	float TurnRate = 0.f;
+	if (Speed > KINDA_SMALL_NUMBER)
 	{
-		return false;
+		TurnRate = FDGMath::HorizontalComponent(Grav, Velocity / Speed).Size() / Speed;
 	}
 
-	// Skip some checks if penetrating. Penetration will be handled by the FindFloor call (using a smaller capsule)
-	if (!Hit.bStartPenetrating)
+	// Turn rate of the gravity direction since the last update.
+	if (DeltaTime > SMALL_NUMBER && !GravDir.IsZero() && !LastFallingGravityNormal.IsZero())
 	{
-		// Reject unwalkable floor normals.
-		if (!IsWalkable(WalkableFloorNormal, Hit))
-		{
-			return false;
-		}
+		TurnRate = FMath::Max(TurnRate, FMath::Acos(FMath::Clamp(GravDir | LastFallingGravityNormal, -1.f, 1.f)) / DeltaTime);
+	}
+	LastFallingGravityNormal = GravDir;
 
-		float PawnRadius, PawnHalfHeight;
-		CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+	const float MaxTurnAngle = FMath::DegreesToRadians(MaxFallingTurnAnglePerSubstep);
+	float TimeStep = TurnRate > SMALL_NUMBER ? MaxTurnAngle / TurnRate : MaxFallingTimeStep;
 
-		// Reject hits that are above our lower hemisphere (can happen when sliding down a vertical surface).
-		// const float LowerHemisphereZ = Hit.Location.Z - PawnHalfHeight + PawnRadius;
-		if (FVector::DotProduct(Hit.ImpactPoint - Hit.Location, -WalkableFloorNormal) < 0)
-		{
-			return false;
-		}
+	// Don't travel farther than the clearance in one substep.
+	const float Clearance = EstimateFallClearance();
+	if (Speed > KINDA_SMALL_NUMBER)
+	{
+		TimeStep = FMath::Min(TimeStep, Clearance / Speed);
+	}
 
-		// Reject hits that are barely on the cusp of the radius of the capsule
-		if (!IsWithinEdgeTolerance(Hit.Location, Hit.ImpactPoint, PawnRadius))
-		{
-			return false;
-		}
+	AdaptiveFallingTimeStep = FMath::Clamp(TimeStep, MinFallingTimeStep, FMath::Max(MinFallingTimeStep, MaxFallingTimeStep));
 
-	}
-	else
+	SET_FLOAT_STAT(STAT_DGFallingTimeStep, AdaptiveFallingTimeStep * 1000.f);
+	SET_FLOAT_STAT(STAT_DGFallingTurnPerSubstep, FMath::RadiansToDegrees(TurnRate * AdaptiveFallingTimeStep));
+	SET_FLOAT_STAT(STAT_DGFallingClearance, Clearance);
+}
+
+float UDGCharacterMovementComponent::GetSimulationTimeStep(float RemainingTime, int32 Iterations) const
+{
+	if (!bAdaptiveFallingSubsteps || !IsFalling())
 	{
-		// Penetrating
-		if (FVector::DotProduct(Hit.Normal, WalkableFloorNormal) < KINDA_SMALL_NUMBER)
-		{
-			// Normal is nearly horizontal or downward, that's a penetration adjustment next to a vertical or overhanging wall. Don't pop to the floor.
-			return false;
-		}
+		return Super::GetSimulationTimeStep(RemainingTime, Iterations);
 	}
 
-	FFindFloorResult FloorResult;
-	FindFloor(CapsuleLocation, FloorResult, false, &Hit);
-
-	if (!FloorResult.IsWalkableFloor())
+	if (RemainingTime > AdaptiveFallingTimeStep && Iterations < MaxSimulationIterations)
 	{
-		return false;
+		// Split the remaining time in half, so the last substep isn't tiny.
+		return FMath::Min(AdaptiveFallingTimeStep, RemainingTime * 0.5f);
 	}
 
-	return true;
+	return FMath::Max(MIN_TICK_TIME, RemainingTime);
 }
 
-bool UDGCharacterMovementComponent::IsWalkable(const FHitResult& Hit) const
+void UDGCharacterMovementComponent::UpdateGravityFrame()
 {
-	return IsWalkable(WalkableFloorNormal(), Hit);
+	GravityFrame.Gravity = Gravity();
+	GravityFrame.GravityDirection = GravityFrame.Gravity.GetSafeNormal();
+	GravityFrame.Up = VerticalDirection;
 }
 
-bool UDGCharacterMovementComponent::IsWalkable(const FVector WalkableFloorNormal, const FHitResult& Hit) const
+void UDGCharacterMovementComponent::PhysFlying(float deltaTime, int32 Iterations)
 {
-	if (!Hit.IsValidBlockingHit())
-	{
-		// No hit, or starting in penetration
-		return false;
-	}
+	SCOPE_CYCLE_COUNTER(STAT_CharPhysFlying);
 
-	float ImpactVerticalSize = FVector::DotProduct(Hit.ImpactNormal, WalkableFloorNormal);
-	// Never walk up vertical surfaces.
-	if (ImpactVerticalSize < KINDA_SMALL_NUMBER)
+	if (deltaTime < MIN_TICK_TIME)
 	{
-		return false;
+		return;
 	}
 
-	float TestWalkableZ = GetWalkableFloorZ();
+	RestorePreAdditiveRootMotionVelocity();
 
-	// See if this component overrides the walkable floor z.
-	const UPrimitiveComponent* HitComponent = Hit.Component.Get();
-	if (HitComponent)
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
 	{
-		const FWalkableSlopeOverride& SlopeOverride = HitComponent->GetWalkableSlopeOverride();
-		TestWalkableZ = SlopeOverride.ModifyWalkableFloorZ(TestWalkableZ);
+		if (bCheatFlying && Acceleration.IsZero())
+		{
+			Velocity = FVector::ZeroVector;
+		}
+		const float Friction = 0.5f * GetPhysicsVolume()->FluidFriction;
+		CalcVelocity(deltaTime, Friction, true, GetMaxBrakingDeceleration());
 	}
 
-	// Can't walk on this surface if it is too steep.
-	if (ImpactVerticalSize < TestWalkableZ)
-	{
-		return false;
-	}
+	ApplyRootMotionToVelocity(deltaTime);
 
-	return true;
+	Iterations++;
+	bJustTeleported = false;
+
+	const FVector Up = GravityFrame.Up;
+	FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector Adjusted = Velocity * deltaTime;
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(Adjusted, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	if (Hit.Time < 1.f)
+	{
+		const float UpDown = -Up | Velocity.GetSafeNormal();
+		bool bSteppedUp = false;
+		if ((FMath::Abs(Hit.ImpactNormal | Up) < 0.2f) && (UpDown < 0.5f) && (UpDown > -0.2f) && CanStepUp(Hit))
+		{
+			const float StepUpHeight = UpdatedComponent->GetComponentLocation() | Up;
+			bSteppedUp = StepUp(-Up, Adjusted * (1.f - Hit.Time), Hit);
+			if (bSteppedUp)
+			{
+				OldLocation += Up * ((UpdatedComponent->GetComponentLocation() | Up) - StepUpHeight);
+			}
+		}
+
+		if (!bSteppedUp)
+		{
+			//adjust and try again
+			HandleImpact(Hit, deltaTime, Adjusted);
+			SlideAlongSurface(Adjusted, (1.f - Hit.Time), Hit.Normal, Hit, true);
+		}
+	}
+
+	if (!bJustTeleported && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / deltaTime;
+	}
+}
+
+void UDGCharacterMovementComponent::PhysSwimming(float deltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharPhysSwimming);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	RestorePreAdditiveRootMotionVelocity();
+
+	const FVector Up = GravityFrame.Up;
+	const float Depth = ImmersionDepth();
+	const float NetBuoyancy = Buoyancy * Depth;
+	const float OriginalAccelUp = Acceleration | Up;
+	bool bLimitedUpAccel = false;
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() && ((Velocity | Up) > 0.33f * MaxSwimSpeed) && (NetBuoyancy != 0.f))
+	{
+		// Damp the upward velocity out of water.
+		const float VelocityUp = Velocity | Up;
+		Velocity += Up * (FMath::Max(0.33f * MaxSwimSpeed, VelocityUp * Depth * Depth) - VelocityUp);
+	}
+	else if (Depth < 0.65f)
+	{
+		bLimitedUpAccel = (OriginalAccelUp > 0.f);
+		Acceleration += Up * (FMath::Min(0.1f, OriginalAccelUp) - OriginalAccelUp);
+	}
+
+	Iterations++;
+	FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	bJustTeleported = false;
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		const float Friction = 0.5f * GetPhysicsVolume()->FluidFriction * Depth;
+		CalcVelocity(deltaTime, Friction, true, GetMaxBrakingDeceleration());
+
+		// Gravity and buoyancy along the vertical direction.
+		Velocity -= Up * (GravityFrame.Gravity.Size() * deltaTime * (1.f - NetBuoyancy));
+	}
+
+	ApplyRootMotionToVelocity(deltaTime);
+
+	FVector Adjusted = Velocity * deltaTime;
+	FHitResult Hit(1.f);
+	const float remainingTime = deltaTime * Swim(Adjusted, Hit);
+
+	//may have left water - if so, script might have set new physics mode
+	if (!IsSwimming())
+	{
+		StartNewPhysics(remainingTime, Iterations);
+		return;
+	}
+
+	if (Hit.Time < 1.f && CharacterOwner)
+	{
+		HandleSwimmingWallHit(Hit, deltaTime);
+		if (bLimitedUpAccel && ((Velocity | Up) >= 0.f))
+		{
+			// allow upward velocity at surface if against obstacle
+			Velocity += Up * (OriginalAccelUp * deltaTime);
+			Adjusted = Velocity * (1.f - Hit.Time) * deltaTime;
+			Swim(Adjusted, Hit);
+			if (!IsSwimming())
+			{
+				StartNewPhysics(remainingTime, Iterations);
+				return;
+			}
+		}
+
+		const float UpDown = -Up | Velocity.GetSafeNormal();
+		bool bSteppedUp = false;
+		if ((FMath::Abs(Hit.ImpactNormal | Up) < 0.2f) && (UpDown < 0.5f) && (UpDown > -0.2f) && CanStepUp(Hit))
+		{
+			const float StepUpHeight = UpdatedComponent->GetComponentLocation() | Up;
+			const FVector RealVelocity = Velocity;
+
+			// Moving up, in case the pawn leaves the water.
+			Velocity = FDGMath::HorizontalComponent(Velocity, Up) + Up;
+			bSteppedUp = StepUp(-Up, Adjusted * (1.f - Hit.Time), Hit);
+			if (bSteppedUp)
+			{
+				//may have left water - if so, script might have set new physics mode
+				if (!IsSwimming())
+				{
+					StartNewPhysics(remainingTime, Iterations);
+					return;
+				}
+				OldLocation += Up * ((UpdatedComponent->GetComponentLocation() | Up) - StepUpHeight);
+			}
+			Velocity = RealVelocity;
+		}
+
+		if (!bSteppedUp)
+		{
+			//adjust and try again
+			HandleImpact(Hit, deltaTime, Adjusted);
+			SlideAlongSurface(Adjusted, (1.f - Hit.Time), Hit.Normal, Hit, true);
+		}
+	}
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity() && !bJustTeleported && ((deltaTime - remainingTime) > KINDA_SMALL_NUMBER) && CharacterOwner)
+	{
+		const bool bWaterJump = !GetPhysicsVolume()->bWaterVolume;
+		const FVector VerticalVelocity = FDGMath::VerticalComponent(Velocity, Up);
+		Velocity = (UpdatedComponent->GetComponentLocation() - OldLocation) / (deltaTime - remainingTime);
+		if (bWaterJump)
+		{
+			Velocity = FDGMath::HorizontalComponent(Velocity, Up) + VerticalVelocity;
+		}
+	}
+
+	if (!GetPhysicsVolume()->bWaterVolume && IsSwimming())
+	{
+		SetMovementMode(MOVE_Falling); //in case script didn't change it (w/ zone change)
+	}
+
+	//may have left water - if so, script might have set new physics mode
+	if (!IsSwimming())
+	{
+		StartNewPhysics(remainingTime, Iterations);
+	}
+}
+
+float UDGCharacterMovementComponent::ImmersionDepth() const
+{
+	float Depth = 0.f;
+
+	if (CharacterOwner && GetPhysicsVolume()->bWaterVolume)
+	{
+		const float CollisionHalfHeight = CharacterOwner->GetSimpleCollisionHalfHeight();
+
+		if ((CollisionHalfHeight == 0.f) || (Buoyancy == 0.f))
+		{
+			Depth = 1.f;
+		}
+		else
+		{
+			UBrushComponent* VolumeBrushComp = GetPhysicsVolume()->GetBrushComponent();
+			FHitResult Hit(1.f);
+			if (VolumeBrushComp)
+			{
+				const FVector CapsuleLocation = UpdatedComponent->GetComponentLocation();
+				const FVector TraceStart = CapsuleLocation + VerticalDirection * CollisionHalfHeight;
+				const FVector TraceEnd = CapsuleLocation - VerticalDirection * CollisionHalfHeight;
+
+				FCollisionQueryParams NewTraceParams(SCENE_QUERY_STAT(ImmersionDepth), true);
+				VolumeBrushComp->LineTraceComponent(Hit, TraceStart, TraceEnd, NewTraceParams);
+			}
+
+			Depth = (Hit.Time == 1.f) ? 1.f : (1.f - Hit.Time);
+		}
+	}
+
+	return Depth;
+}
+
+FVector UDGCharacterMovementComponent::GravityAt(const FVector& Location) const
+{
+	const UDGGravitySubsystem* GravitySubsystem = bSampleGravityFields ? GetWorld()->GetSubsystem<UDGGravitySubsystem>() : NULL;
+	if (GravitySubsystem == NULL)
+	{
+		return Gravity();
+	}
+
+	const FVector Dynamic = DynamicGravity + GravitySubsystem->SampleGravity(Location);
+	return (GetIgnoreWorldGravityIfDynamicGravityIsNotZero() && !Dynamic.Equals(FVector::ZeroVector)) ? Dynamic : WorldGravity() + Dynamic;
+}
+
+float UDGCharacterMovementComponent::GetOrbitalAltitude(const FVector& Location) const
+{
+	const UDGGravitySubsystem* GravitySubsystem = GetWorld()->GetSubsystem<UDGGravitySubsystem>();
+	const UDGGravityFieldComponent* Field = GravitySubsystem != NULL ? GravitySubsystem->FindDominantPointField(Location) : NULL;
+	if (Field == NULL)
+	{
+		return -1.f;
+	}
+
+	return FMath::Max(0.f, FVector::Dist(Location, Field->GetComponentLocation()) - Field->SurfaceRadius);
+}
+
+bool UDGCharacterMovementComponent::ShouldStartOrbiting() const
+{
+	if (!bEnableOrbitalMovement || !bSampleGravityFields || !IsFalling() || HasAnimRootMotion() || CurrentRootMotion.HasOverrideVelocity())
+	{
+		return false;
+	}
+
+	return GetOrbitalAltitude(UpdatedComponent->GetComponentLocation()) >= OrbitalEnterAltitude;
+}
+
+void UDGCharacterMovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == (uint8)EDGCustomMovementMode::CMOVE_Orbital)
+	{
+		PhysOrbital(DeltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(DeltaTime, Iterations);
+}
+
+void UDGCharacterMovementComponent::PhysOrbital(float DeltaTime, int32 Iterations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharPhysOrbital);
+
+	if (DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	if (!bEnableOrbitalMovement || !bSampleGravityFields || GetOrbitalAltitude(UpdatedComponent->GetComponentLocation()) < GetOrbitalExitAltitude())
+	{
+		StopOrbiting(DeltaTime, Iterations);
+		return;
+	}
+
+	EstimateFallClearance();
+
+	// The move is split into equal steps, without a remainder or a gravity carried to the next move, so replayed moves give the same orbit.
+	const int32 MaxSteps = FMath::Max(MaxSimulationIterations - Iterations, 1);
+	const int32 NumSteps = FMath::Clamp(FMath::CeilToInt(DeltaTime / FMath::Max(OrbitalTimeStep, MIN_TICK_TIME)), 1, MaxSteps);
+	const float timeTick = DeltaTime / NumSteps;
+	float remainingTime = DeltaTime;
+
+	FVector Acceleration = GravityAt(UpdatedComponent->GetComponentLocation());
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		Iterations++;
+		remainingTime -= timeTick;
+
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		const FQuat PawnRotation = UpdatedComponent->GetComponentQuat();
+		bJustTeleported = false;
+
+		// Velocity Verlet: half kick, drift, and half kick with the gravity at the new location.
+		const FVector HalfStepVelocity = Velocity + Acceleration * (0.5f * timeTick);
+		const FVector Delta = HalfStepVelocity * timeTick;
+
+		// Only sweep near geometry.
+		FHitResult Hit(1.f);
+		if (Delta.SizeSquared() < FMath::Square(GetCachedFallClearance(OldLocation)))
+		{
+			INC_DWORD_STAT(STAT_DGFallingUnsweptMoves);
+			MoveUpdatedComponent(Delta, PawnRotation, false);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_DGFallingSweeps);
+			SafeMoveUpdatedComponent(Delta, PawnRotation, true, Hit);
+		}
+
+		if (!HasValidData())
+		{
+			return;
+		}
+
+		if (Hit.bBlockingHit)
+		{
+			// The falling physics lands or slides on the surface.
+			Velocity = HalfStepVelocity;
+			StopOrbiting(remainingTime + timeTick * (1.f - Hit.Time), Iterations);
+			return;
+		}
+
+		const FVector NewLocation = UpdatedComponent->GetComponentLocation();
+		Acceleration = GravityAt(NewLocation);
+		Velocity = HalfStepVelocity + Acceleration * (0.5f * timeTick);
+
+		if (GetOrbitalAltitude(NewLocation) < GetOrbitalExitAltitude())
+		{
+			StopOrbiting(remainingTime, Iterations);
+			return;
+		}
+	}
+}
+
+void UDGCharacterMovementComponent::StopOrbiting(float DeltaTime, int32 Iterations)
+{
+	SetMovementMode(MOVE_Falling);
+	StartNewPhysics(DeltaTime, Iterations + 1);
+}
+
+bool UDGCharacterMovementComponent::PredictFallTrajectory(const FDGFallPredictionParams& Params, FDGFallPredictionResult& OutResult) const
+{
+	TArray<FDGFallPredictionParams> ParamsArray;
+	ParamsArray.Add(Params);
+
+	TArray<FDGFallPredictionResult> Results;
+	PredictFallTrajectories(ParamsArray, Results);
+
+	OutResult = MoveTemp(Results[0]);
+	return OutResult.bHit;
+}
+
+bool UDGCharacterMovementComponent::PredictCurrentFallTrajectory(float MaxSimTime, FDGFallPredictionResult& OutResult) const
+{
+	if (UpdatedComponent == NULL)
+	{
+		OutResult = FDGFallPredictionResult();
+		return false;
+	}
+
+	FDGFallPredictionParams Params;
+	Params.StartLocation = UpdatedComponent->GetComponentLocation();
+	Params.StartVelocity = Velocity;
+	Params.InputAcceleration = Acceleration;
+	Params.MaxSimTime = MaxSimTime;
+	return PredictFallTrajectory(Params, OutResult);
+}
+
+void UDGCharacterMovementComponent::PredictFallTrajectories(const TArray<FDGFallPredictionParams>& Params, TArray<FDGFallPredictionResult>& OutResults) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharPredictFallTrajectory);
+
+	const int32 NumFalls = Params.Num();
+	OutResults.Reset(NumFalls);
+	OutResults.AddDefaulted(NumFalls);
+
+	if (!HasValidData() || NumFalls == 0)
+	{
+		return;
+	}
+
+	const UDGGravitySubsystem* GravitySubsystem = bSampleGravityFields ? GetWorld()->GetSubsystem<UDGGravitySubsystem>() : NULL;
+	const FCollisionShape CapsuleShape = GetPawnCapsuleCollisionShape(SHRINK_None);
+	const FCollisionQueryParams& QueryParams = GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(PredictFallTrajectory));
+	const ECollisionChannel CollisionChannel = UpdatedComponent->GetCollisionObjectType();
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+	const float TerminalVelocity = GetPhysicsVolume()->TerminalVelocity;
+	const float MaxSpeed = GetMaxSpeed();
+	const float MaxAccel = GetMaxAcceleration();
+
+	// State of each fall. Finished falls are removed from ActiveFalls.
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<float> Times;
+	TArray<int32> ActiveFalls;
+	Locations.SetNumUninitialized(NumFalls);
+	Velocities.SetNumUninitialized(NumFalls);
+	Times.SetNumZeroed(NumFalls);
+	ActiveFalls.Reserve(NumFalls);
+	for (int32 Index = 0; Index < NumFalls; ++Index)
+	{
+		Locations[Index] = Params[Index].StartLocation;
+		Velocities[Index] = Params[Index].StartVelocity;
+		OutResults[Index].PathPoints.Add(Params[Index].StartLocation);
+		ActiveFalls.Add(Index);
+	}
+
+	TArray<FVector> SampleLocations;
+	TArray<FVector> SampledGravity;
+	while (ActiveFalls.Num() > 0)
+	{
+		// Sample the gravity fields of all the active falls in one pass.
+		const int32 NumActive = ActiveFalls.Num();
+		SampledGravity.SetNumUninitialized(NumActive, false);
+		if (GravitySubsystem != NULL)
+		{
+			SampleLocations.SetNumUninitialized(NumActive, false);
+			for (int32 Active = 0; Active < NumActive; ++Active)
+			{
+				SampleLocations[Active] = Locations[ActiveFalls[Active]];
+			}
+			GravitySubsystem->SampleGravityBatch(SampleLocations.GetData(), NumActive, SampledGravity.GetData());
+		}
+		else
+		{
+			for (int32 Active = 0; Active < NumActive; ++Active)
+			{
+				SampledGravity[Active] = FieldGravity;
+			}
+		}
+
+		for (int32 Active = NumActive - 1; Active >= 0; --Active)
+		{
+			const int32 Index = ActiveFalls[Active];
+			const FDGFallPredictionParams& FallParams = Params[Index];
+			FDGFallPredictionResult& Result = OutResults[Index];
+
+			const FVector FallDynamicGravity = DynamicGravity + SampledGravity[Active];
+			const FVector Grav = (GetIgnoreWorldGravityIfDynamicGravityIsNotZero() && !FallDynamicGravity.Equals(FVector::ZeroVector)) ? FallDynamicGravity : WorldGravity() + FallDynamicGravity;
+			const FVector GravDir = Grav.GetSafeNormal();
+
+			// Air control, as in GetFallingLateralAcceleration, without accelerating past the max speed.
+			const FVector OldLocation = Locations[Index];
+			const FVector OldVelocity = Velocities[Index];
+			const FVector HorizontalVelocity = FDGMath::HorizontalComponent(OldVelocity, GravDir);
+			float TickAirControl = AirControl;
+			if (AirControlBoostMultiplier > 0.f && HorizontalVelocity.SizeSquared() < FMath::Square(AirControlBoostVelocityThreshold))
+			{
+				TickAirControl = FMath::Min(1.f, AirControlBoostMultiplier * TickAirControl);
+			}
+			FVector AirAcceleration = (FDGMath::HorizontalComponent(FallParams.InputAcceleration, GravDir) * TickAirControl).GetClampedToMaxSize(MaxAccel);
+			if (HorizontalVelocity.SizeSquared() >= FMath::Square(MaxSpeed) && (AirAcceleration | HorizontalVelocity) > 0.f)
+			{
+				AirAcceleration = FDGMath::HorizontalComponent(AirAcceleration, HorizontalVelocity.GetSafeNormal());
+			}
+			const FVector TotalAcceleration = Grav + AirAcceleration;
+
+			// A parabola strays at most a * t^2 / 8 from its chord.
+			const float AccelSize = TotalAcceleration.Size();
+			float TimeStep = FMath::Min(FallParams.MaxSweepInterval, FallParams.MaxSimTime - Times[Index]);
+			if (AccelSize > KINDA_SMALL_NUMBER)
+			{
+				TimeStep = FMath::Min(TimeStep, FMath::Sqrt(8.f * FallParams.MaxChordError / AccelSize));
+			}
+			TimeStep = FMath::Max(TimeStep, MIN_TICK_TIME);
+
+			const FVector NewLocation = OldLocation + OldVelocity * TimeStep + 0.5f * TotalAcceleration * FMath::Square(TimeStep);
+			FVector NewVelocity = OldVelocity + TotalAcceleration * TimeStep;
+			const FVector NewVerticalVelocity = FDGMath::VerticalComponent(NewVelocity, GravDir);
+			if (TerminalVelocity > 0.f && (NewVerticalVelocity | GravDir) > TerminalVelocity)
+			{
+				NewVelocity += GravDir * (TerminalVelocity - (NewVerticalVelocity | GravDir));
+			}
+
+			FHitResult Hit;
+			const FQuat CapsuleQuat = FDGMath::MakeQuatFromZX(-GravDir, Forward);
+			const bool bBlockingHit = GetWorld()->SweepSingleByChannel(Hit, OldLocation, NewLocation, CapsuleQuat, CollisionChannel, CapsuleShape, QueryParams, CachedCollisionResponseParams);
+			Result.NumSweeps++;
+
+			if (bBlockingHit)
+			{
+				const float HitTime = TimeStep * Hit.Time;
+				Result.bHit = true;
+				Result.bWalkable = !GravDir.IsZero() && IsWalkable(-GravDir, Hit);
+				Result.LandingLocation = Hit.Location;
+				Result.ImpactPoint = Hit.ImpactPoint;
+				Result.ImpactNormal = Hit.ImpactNormal;
+				Result.LandingVelocity = OldVelocity + TotalAcceleration * HitTime;
+				Result.LandingTime = Times[Index] + HitTime;
+				Result.PathPoints.Add(Hit.Location);
+				ActiveFalls.RemoveAtSwap(Active, 1, false);
+				continue;
+			}
+
+			Locations[Index] = NewLocation;
+			Velocities[Index] = NewVelocity;
+			Times[Index] += TimeStep;
+			Result.PathPoints.Add(NewLocation);
+
+			if (Times[Index] >= FallParams.MaxSimTime || Result.NumSweeps >= FallParams.MaxSweeps)
+			{
+				Result.LandingLocation = NewLocation;
+				Result.LandingVelocity = NewVelocity;
+				Result.LandingTime = Times[Index];
+				ActiveFalls.RemoveAtSwap(Active, 1, false);
+			}
+		}
+	}
+}
+
+void UDGCharacterMovementComponent::FindFloor(const FVector WalkableFloorNormal, const FRotator Rot, FVector CapsuleLocation, FFindFloorResult& FloorResult) const
+{
+	const bool SavedForceNextFloorCheck(bForceNextFloorCheck);
+	FindFloor(WalkableFloorNormal, Rot, CapsuleLocation, FloorResult, false);
+
+	// FindFloor clears this, but this is only a test not done during normal movement.
+	UDGCharacterMovementComponent* MutableThis = const_cast<UDGCharacterMovementComponent*>(this);
+	MutableThis->bForceNextFloorCheck = SavedForceNextFloorCheck;
+}
+
+
+void UDGCharacterMovementComponent::ComputeFloorDist(const FVector WalkableFloorNormal, const FRotator Rot, FVector CapsuleLocation, float LineDistance, float SweepDistance, float SweepRadius, FFindFloorResult& FloorResult) const
+{
+	if (HasValidData())
+	{
+		SweepDistance = FMath::Max(SweepDistance, 0.f);
+		LineDistance = FMath::Clamp(LineDistance, 0.f, SweepDistance);
+		SweepRadius = FMath::Max(SweepRadius, 0.f);
+
+		ComputeFloorDist(WalkableFloorNormal, Rot, CapsuleLocation, LineDistance, SweepDistance, FloorResult, SweepRadius);
+	}
+}
+
+bool UDGCharacterMovementComponent::IsValidLandingSpot(const FVector& CapsuleLocation, const FHitResult& Hit) const
+{
+	FVector WalkableFloorNormal = this->WalkableFloorNormal();
+
+	if (!Hit.bBlockingHit)
+	{
+		return false;
+	}
+
+	// Skip some checks if penetrating. Penetration will be handled by the FindFloor call (using a smaller capsule)
+	if (!Hit.bStartPenetrating)
+	{
+		// Reject unwalkable floor normals.
+		if (!IsWalkable(WalkableFloorNormal, Hit))
+		{
+			return false;
+		}
+
+		float PawnRadius, PawnHalfHeight;
+		CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(PawnRadius, PawnHalfHeight);
+
+		// Reject hits that are above our lower hemisphere (can happen when sliding down a vertical surface).
+		// const float LowerHemisphereZ = Hit.Location.Z - PawnHalfHeight + PawnRadius;
+		if (FVector::DotProduct(Hit.ImpactPoint - Hit.Location, -WalkableFloorNormal) < 0)
+		{
+			return false;
+		}
+
+		// Reject hits that are barely on the cusp of the radius of the capsule
+		if (!IsWithinEdgeTolerance(Hit.Location, Hit.ImpactPoint, PawnRadius))
+		{
+			return false;
+		}
+
+	}
+	else
+	{
+		// Penetrating
+		if (FVector::DotProduct(Hit.Normal, WalkableFloorNormal) < KINDA_SMALL_NUMBER)
+		{
+			// Normal is nearly horizontal or downward, that's a penetration adjustment next to a vertical or overhanging wall. Don't pop to the floor.
+			return false;
+		}
+	}
+
+	FFindFloorResult FloorResult;
+	FindFloor(CapsuleLocation, FloorResult, false, &Hit);
+
+	if (!FloorResult.IsWalkableFloor())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool UDGCharacterMovementComponent::IsWalkable(const FHitResult& Hit) const
+{
+	return IsWalkable(WalkableFloorNormal(), Hit);
+}
+
+bool UDGCharacterMovementComponent::IsWalkable(const FVector WalkableFloorNormal, const FHitResult& Hit) const
+{
+	if (!Hit.IsValidBlockingHit())
+	{
+		// No hit, or starting in penetration
+		return false;
+	}
+
+	float ImpactVerticalSize = FVector::DotProduct(Hit.ImpactNormal, WalkableFloorNormal);
+	// Never walk up vertical surfaces.
+	if (ImpactVerticalSize < KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	float TestWalkableZ = GetWalkableFloorZ();
+
+	// See if this component overrides the walkable floor z.
+	const UPrimitiveComponent* HitComponent = Hit.Component.Get();
+	if (HitComponent)
+	{
+		const FWalkableSlopeOverride& SlopeOverride = HitComponent->GetWalkableSlopeOverride();
+		TestWalkableZ = SlopeOverride.ModifyWalkableFloorZ(TestWalkableZ);
+	}
+
+	// Can't walk on this surface if it is too steep.
+	if (ImpactVerticalSize < TestWalkableZ)
+	{
+		return false;
+	}
+
+	return true;
 }
 
 bool UDGCharacterMovementComponent::IsWithinEdgeTolerance(const FVector& CapsuleLocation, const FVector& TestImpactPoint, const float CapsuleRadius) const
@@ -2188,7 +3510,12 @@ void UDGCharacterMovementComponent::FindFloor(const FVector WalkableFloorNormal,
 	{
 		UDGCharacterMovementComponent* MutableThis = const_cast<UDGCharacterMovementComponent*>(this);
 
-		if (bAlwaysCheckFloor || !bZeroDelta || bForceNextFloorCheck || bJustTeleported)
+		if (bCacheFloorInBaseFrame && !bForceNextFloorCheck && !bJustTeleported && &OutFloorResult == &CurrentFloor && RefreshFloorFromBaseFrame(CapsuleLocation, WalkableFloorNormal))
+		{
+			// The floor moved with the base, whether the character stood or walked on it.
+			bNeedToValidateFloor = false;
+		}
+		else if (bAlwaysCheckFloor || !bZeroDelta || bForceNextFloorCheck || bJustTeleported)
 		{
 			MutableThis->bForceNextFloorCheck = false;
 			ComputeFloorDist(CapsuleLocation, FloorLineTraceDist, FloorSweepTraceDist, OutFloorResult, CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleRadius(), DownwardSweepResult);
@@ -2212,7 +3539,10 @@ void UDGCharacterMovementComponent::FindFloor(const FVector WalkableFloorNormal,
 			if (!bForceNextFloorCheck && !IsActorBasePendingKill && MovementBase)
 			{
 				//UE_LOG(LogCharacterMovement, Log, TEXT("%s SKIP check for floor"), *CharacterOwner->GetName());
-				OutFloorResult = CurrentFloor;
+				if (&OutFloorResult != &CurrentFloor)
+				{
+					OutFloorResult = CurrentFloor;
+				}
 				bNeedToValidateFloor = false;
 			}
 			else
@@ -2261,6 +3591,260 @@ void UDGCharacterMovementComponent::FindFloor(const FVector WalkableFloorNormal,
 			}
 		}
 	}
+
+	if (bCacheFloorInBaseFrame && bNeedToValidateFloor && &OutFloorResult == &CurrentFloor)
+	{
+		CacheFloorInBaseFrame(CapsuleLocation, WalkableFloorNormal);
+	}
+}
+
+void UDGCharacterMovementComponent::CacheFloorInBaseFrame(const FVector& CapsuleLocation, const FVector& WalkableNormal) const
+{
+	bBaseFloorValid = false;
+
+	UPrimitiveComponent* FloorComponent = CurrentFloor.HitResult.Component.Get();
+	if (!CurrentFloor.IsWalkableFloor() || !MovementBaseUtility::IsDynamicBase(FloorComponent))
+	{
+		return;
+	}
+
+	FVector BaseLocation;
+	FQuat BaseQuat;
+	if (!MovementBaseUtility::GetMovementBaseTransform(FloorComponent, CurrentFloor.HitResult.BoneName, BaseLocation, BaseQuat))
+	{
+		return;
+	}
+
+	const FTransform BaseTransform(BaseQuat, BaseLocation);
+	const FHitResult& Hit = CurrentFloor.HitResult;
+	BaseFloorComponent = FloorComponent;
+	BaseFloorBoneName = Hit.BoneName;
+	BaseFloorCapsuleLocation = BaseTransform.InverseTransformPositionNoScale(CapsuleLocation);
+	BaseFloorLocation = BaseTransform.InverseTransformPositionNoScale(Hit.Location);
+	BaseFloorImpactPoint = BaseTransform.InverseTransformPositionNoScale(Hit.ImpactPoint);
+	BaseFloorNormal = BaseQuat.UnrotateVector(Hit.Normal);
+	BaseFloorImpactNormal = BaseQuat.UnrotateVector(Hit.ImpactNormal);
+	BaseFloorUp = BaseQuat.UnrotateVector(WalkableNormal);
+	BaseFloorDist = CurrentFloor.FloorDist;
+	BaseFloorLineDist = CurrentFloor.LineDist;
+	BaseFloorWrittenImpactPoint = Hit.ImpactPoint;
+	bBaseFloorValid = true;
+}
+
+bool UDGCharacterMovementComponent::RefreshFloorFromBaseFrame(const FVector& CapsuleLocation, const FVector& WalkableNormal) const
+{
+	UPrimitiveComponent* MovementBase = CharacterOwner->GetMovementBase();
+	if (!bBaseFloorValid || MovementBase == NULL || BaseFloorComponent.Get() != MovementBase || BaseFloorBoneName != CharacterOwner->GetBasedMovement().BoneName)
+	{
+		return false;
+	}
+
+	if (!CurrentFloor.IsWalkableFloor() || CurrentFloor.HitResult.ImpactPoint != BaseFloorWrittenImpactPoint)
+	{
+		// CurrentFloor was replaced since it was cached.
+		bBaseFloorValid = false;
+		return false;
+	}
+
+	FVector BaseLocation;
+	FQuat BaseQuat;
+	if (!MovementBaseUtility::GetMovementBaseTransform(MovementBase, BaseFloorBoneName, BaseLocation, BaseQuat))
+	{
+		return false;
+	}
+
+	// The floor is found along the walkable floor normal, so it only holds while that normal doesn't turn in the frame of the base.
+	if ((BaseQuat.UnrotateVector(WalkableNormal) | BaseFloorUp) < THRESH_NORMALS_ARE_PARALLEL)
+	{
+		return false;
+	}
+
+	const FTransform BaseTransform(BaseQuat, BaseLocation);
+	const FVector Move = BaseTransform.InverseTransformPositionNoScale(CapsuleLocation) - BaseFloorCapsuleLocation;
+	if (Move.SizeSquared() > FMath::Square(BaseFloorCacheTolerance))
+	{
+		// Farther moves keep the floor plane, near where it was found and unless the floor was an edge.
+		if (CurrentFloor.bLineTrace
+			|| (BaseFloorNormal | BaseFloorImpactNormal) < THRESH_NORMALS_ARE_PARALLEL
+			|| FDGMath::HorizontalComponent(Move, BaseFloorImpactNormal).SizeSquared() > FMath::Square(BaseFloorCacheRadius))
+		{
+			return false;
+		}
+	}
+
+	const float NormalDotUp = BaseFloorImpactNormal | BaseFloorUp;
+	if (NormalDotUp <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	// The capsule slides on the floor plane, so the floor distance only changes with the move along the plane normal.
+	const float FloorDistChange = (Move | BaseFloorImpactNormal) / NormalDotUp;
+	const float FloorDist = BaseFloorDist + FloorDistChange;
+	if (FloorDist < 0.f || FloorDist > MAX_FLOOR_DIST)
+	{
+		return false;
+	}
+
+	const FVector PlaneMove = Move - BaseFloorUp * FloorDistChange;
+
+	FFindFloorResult& Floor = const_cast<UDGCharacterMovementComponent*>(this)->CurrentFloor;
+	Floor.FloorDist = FloorDist;
+	Floor.LineDist = BaseFloorLineDist + FloorDistChange;
+
+	FHitResult& Hit = Floor.HitResult;
+	Hit.Location = BaseTransform.TransformPositionNoScale(BaseFloorLocation + PlaneMove);
+	Hit.ImpactPoint = BaseTransform.TransformPositionNoScale(BaseFloorImpactPoint + PlaneMove);
+	Hit.Normal = BaseQuat.RotateVector(BaseFloorNormal);
+	Hit.ImpactNormal = BaseQuat.RotateVector(BaseFloorImpactNormal);
+	Hit.TraceStart = CapsuleLocation;
+	Hit.TraceEnd = CapsuleLocation + (Hit.Location - CapsuleLocation) / FMath::Max(Hit.Time, KINDA_SMALL_NUMBER);
+	BaseFloorWrittenImpactPoint = Hit.ImpactPoint;
+	return true;
+}
+
+FVector UDGCharacterMovementComponent::GetImpartedMovementBaseVelocity() const
+{
+	FVector Result = FVector::ZeroVector;
+	if (CharacterOwner)
+	{
+		UPrimitiveComponent* MovementBase = CharacterOwner->GetMovementBase();
+		if (MovementBaseUtility::IsDynamicBase(MovementBase))
+		{
+			FVector BaseVelocity = MovementBaseUtility::GetMovementBaseVelocity(MovementBase, CharacterOwner->GetBasedMovement().BoneName);
+
+			if (bImpartBaseAngularVelocity)
+			{
+				const FVector BaseTangentialVel = MovementBaseUtility::GetMovementBaseTangentialVelocity(MovementBase, CharacterOwner->GetBasedMovement().BoneName, GetGravityFeetLocation());
+				BaseVelocity += BaseTangentialVel;
+			}
+
+			FVector VerticalVelocity;
+			FVector HorizontalVelocity;
+			FDGMath::Decompose(BaseVelocity, VerticalDirection, VerticalVelocity, HorizontalVelocity);
+
+			if (bImpartBaseVelocityX || bImpartBaseVelocityY)
+			{
+				Result += HorizontalVelocity;
+			}
+			if (bImpartBaseVelocityZ)
+			{
+				Result += VerticalVelocity;
+			}
+		}
+	}
+
+	return Result;
+}
+
+void UDGCharacterMovementComponent::UpdateBasedMovement(float DeltaSeconds)
+{
+	if (!HasValidData())
+	{
+		return;
+	}
+
+	const UPrimitiveComponent* MovementBase = CharacterOwner->GetMovementBase();
+	if (!MovementBaseUtility::UseRelativeLocation(MovementBase))
+	{
+		return;
+	}
+
+	if (!IsValid(MovementBase) || !IsValid(MovementBase->GetOwner()))
+	{
+		SetBase(NULL);
+		return;
+	}
+
+	// Ignore collision with bases during these movements.
+	TGuardValue<EMoveComponentFlags> ScopedFlagRestore(MoveComponentFlags, MoveComponentFlags | MOVECOMP_IgnoreBases);
+
+	FQuat NewBaseQuat;
+	FVector NewBaseLocation;
+	if (!MovementBaseUtility::GetMovementBaseTransform(MovementBase, CharacterOwner->GetBasedMovement().BoneName, NewBaseLocation, NewBaseQuat))
+	{
+		return;
+	}
+
+	const bool bRotationChanged = !OldBaseQuat.Equals(NewBaseQuat, 1e-8f);
+	if (!bRotationChanged && OldBaseLocation == NewBaseLocation)
+	{
+		return;
+	}
+
+	const FQuat DeltaQuat = bRotationChanged ? NewBaseQuat * OldBaseQuat.Inverse() : FQuat::Identity;
+	const FQuat PawnOldQuat = UpdatedComponent->GetComponentQuat();
+	FQuat FinalQuat = PawnOldQuat;
+
+	if (bRotationChanged && !bIgnoreBaseRotation)
+	{
+		// The full rotation of the base, since the gravity turns with it.
+		FinalQuat = DeltaQuat * PawnOldQuat;
+
+		if (bRotateDynamicGravityWithBase)
+		{
+			DynamicGravity = DeltaQuat.RotateVector(DynamicGravity);
+			VerticalDirection = DeltaQuat.RotateVector(VerticalDirection);
+		}
+
+		// Pipe through ControlRotation, to affect camera.
+		if (CharacterOwner->Controller)
+		{
+			FRotator FinalRotation = FinalQuat.Rotator();
+			UpdateBasedRotation(FinalRotation, DeltaQuat.Rotator());
+		}
+	}
+
+	// Offset the feet of the character, not its origin.
+	const float HalfHeight = CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FVector BaseOffset = VerticalDirection * HalfHeight;
+	FVector DeltaPosition;
+	if (bRotationChanged)
+	{
+		const FTransform OldLocalToWorld(OldBaseQuat, OldBaseLocation);
+		const FTransform NewLocalToWorld(NewBaseQuat, NewBaseLocation);
+		const FVector LocalBasePos = OldLocalToWorld.InverseTransformPositionNoScale(UpdatedComponent->GetComponentLocation() - BaseOffset);
+		const FVector NewWorldPos = ConstrainLocationToPlane(NewLocalToWorld.TransformPositionNoScale(LocalBasePos) + BaseOffset);
+		DeltaPosition = ConstrainDirectionToPlane(NewWorldPos - UpdatedComponent->GetComponentLocation());
+	}
+	else
+	{
+		// A pure translation, without the error of the transforms.
+		DeltaPosition = ConstrainDirectionToPlane(NewBaseLocation - OldBaseLocation);
+	}
+
+	if (bFastAttachedMove)
+	{
+		// we're trusting no other obstacle can prevent the move here
+		UpdatedComponent->SetWorldLocationAndRotation(UpdatedComponent->GetComponentLocation() + DeltaPosition, FinalQuat, false);
+	}
+	else
+	{
+		FHitResult MoveOnBaseHit(1.f);
+		const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+		MoveUpdatedComponent(DeltaPosition, FinalQuat, true, &MoveOnBaseHit);
+		if ((UpdatedComponent->GetComponentLocation() - (OldLocation + DeltaPosition)).IsNearlyZero() == false)
+		{
+			OnUnableToFollowBaseMove(DeltaPosition, OldLocation, MoveOnBaseHit);
+		}
+	}
+
+	if (MovementBase->IsSimulatingPhysics() && CharacterOwner->GetMesh())
+	{
+		CharacterOwner->GetMesh()->ApplyDeltaToAllPhysicsTransforms(DeltaPosition, DeltaQuat);
+	}
+}
+
+void UDGCharacterMovementComponent::UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation)
+{
+	// The view of a ADGCharacter is relative to its view rotation base, which follows the gravity, so only the plain control rotation is turned with the base.
+	AController* Controller = CharacterOwner ? CharacterOwner->Controller : NULL;
+	const ADGCharacter* DGCharacter = Cast<ADGCharacter>(CharacterOwner);
+	const bool bViewFollowsGravity = DGCharacter != NULL && DGCharacter->GetViewRotationBaseMode() != EViewRotationBaseMode::VRM_ControlRotation;
+	if (Controller && !bIgnoreBaseRotation && !bViewFollowsGravity)
+	{
+		Controller->SetControlRotation((ReducedRotation.Quaternion() * Controller->GetControlRotation().Quaternion()).Rotator());
+	}
 }
 
 void UDGCharacterMovementComponent::ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult) const
@@ -2306,9 +3890,8 @@ void UDGCharacterMovementComponent::ComputeFloorDist(const FVector WalkableFloor
 	}
 
 	bool bBlockingHit = false;
-	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ComputeFloorDist), false, CharacterOwner);
-	FCollisionResponseParams ResponseParam;
-	InitCollisionParams(QueryParams, ResponseParam);
+	const FCollisionQueryParams& QueryParams = GetCachedCollisionParams(SCENE_QUERY_STAT_NAME_ONLY(ComputeFloorDist));
+	const FCollisionResponseParams& ResponseParam = CachedCollisionResponseParams;
 	const ECollisionChannel CollisionChannel = UpdatedComponent->GetCollisionObjectType();
 
 	// Sweep test
@@ -2392,7 +3975,7 @@ void UDGCharacterMovementComponent::ComputeFloorDist(const FVector WalkableFloor
 		const FVector LineTraceStart = CapsuleLocation;
 		const float TraceDist = LineDistance + ShrinkHeight;
 		const FVector Down = -WalkableFloorNormal * TraceDist/*FVector(0.f, 0.f, -TraceDist)*/;
-		QueryParams.TraceTag = SCENE_QUERY_STAT_NAME_ONLY(FloorLineTrace);
+		CachedCollisionQueryParams.TraceTag = SCENE_QUERY_STAT_NAME_ONLY(FloorLineTrace);
 
 		FHitResult Hit(1.f);
 		bBlockingHit = GetWorld()->LineTraceSingleByChannel(Hit, LineTraceStart, LineTraceStart + Down, CollisionChannel, QueryParams, ResponseParam);
@@ -2512,7 +4095,7 @@ void UDGCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 	if (ShouldRemainVertical())
 	{
 		FVector NewVerticalDirection;
-		switch (PhysicsRotationVerticalDirectionMode)
+		switch (GetPhysicsRotationVerticalDirectionMode())
 		{
 		case EPhysicsRotationVerticalDirectionMode::PRVDM_Gravity:
 			NewVerticalDirection = -GravityNormal();
@@ -2527,7 +4110,7 @@ void UDGCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 			NewVerticalDirection = this->VerticalDirection;
 			break;
 		default:
-			NewVerticalDirection = FRotationMatrix(this->RotationRate).GetScaledAxis(EAxis::Z);
+			NewVerticalDirection = FRotationMatrix(GetCustomPhysicsRotationVerticalDirection()).GetScaledAxis(EAxis::Z);
 		}
 
 		DesiredRotation = FRotationMatrix::MakeFromZX(NewVerticalDirection, FRotationMatrix(DesiredRotation).GetScaledAxis(EAxis::X)).Rotator();
@@ -2541,13 +4124,14 @@ void UDGCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 	{
 		// Lerp the rotation.
 
+		const float AdjustIntensity = GetRotationAdjustIntensity();
 		float Alpha;
-		if (RotationAdjustIntensity < 0)
+		if (AdjustIntensity < 0)
 		{
 			Alpha = 1;
 		}
 		else {
-			Alpha = RotationAdjustIntensity * DeltaTime;
+			Alpha = AdjustIntensity * DeltaTime;
 			if (Alpha > 1) Alpha = 1;
 		}
 		FRotator DeltaAngle = DesiredRotation - CurrentRotation;
@@ -2555,8 +4139,7 @@ void UDGCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 		FQuat AQuat(CurrentRotation);
 		FQuat BQuat(DesiredRotation);
 
-		FQuat Result = FQuat::Slerp(AQuat, BQuat, Alpha);
-		Result.Normalize();
+		const FQuat Result = FDGMath::Slerp(AQuat, BQuat, Alpha);
 		DesiredRotation = Result.Rotator();
 
 		DesiredRotation.Normalize();
@@ -2570,6 +4153,188 @@ void UDGCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 
 void UDGCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
+	FieldGravity = FVector::ZeroVector;
+	if (bSampleGravityFields && !bSurfacePathGravitySaved && UpdatedComponent != NULL)
+	{
+		// The surface path replaces the whole gravity while it aligns it.
+		if (const UDGGravitySubsystem* GravitySubsystem = GetWorld()->GetSubsystem<UDGGravitySubsystem>())
+		{
+			FieldGravity = GravitySubsystem->SampleGravity(UpdatedComponent->GetComponentLocation());
+		}
+	}
+
 	UpdateVerticalDirection();
+	UpdateGravityFrame();
+	FollowSurfacePath(DeltaTime);
 	UCharacterMovementComponent::TickComponent(DeltaTime, TickType, ThisTickFunction);
-}
\ No newline at end of file
+	UpdateKinematics();
+	NotifyGravityChanges();
+}
+
+void UDGCharacterMovementComponent::UpdateKinematics()
+{
+	Kinematics.Velocity = Velocity;
+	Kinematics.VerticalDirection = VerticalDirection;
+	FDGMath::Decompose(Velocity, VerticalDirection, Kinematics.VerticalVelocity, Kinematics.HorizontalVelocity);
+	Kinematics.Speed = Velocity.Size();
+	Kinematics.HorizontalSpeed = Kinematics.HorizontalVelocity.Size();
+	Kinematics.VerticalSpeed = Kinematics.VerticalVelocity.Size();
+
+	Kinematics.Gravity = GravityFrame.Gravity;
+	Kinematics.GravityNormal = GravityFrame.GravityDirection;
+
+	Kinematics.MovementMode = MovementMode;
+	Kinematics.bIsMovingOnGround = IsMovingOnGround();
+	Kinematics.bIsFalling = IsFalling();
+
+	bKinematicsNormalsValid = false;
+}
+
+const FDGKinematicsSnapshot& UDGCharacterMovementComponent::GetKinematics() const
+{
+	if (!bKinematicsNormalsValid)
+	{
+		UpdateKinematicsNormals();
+	}
+
+	return Kinematics;
+}
+
+void UDGCharacterMovementComponent::UpdateKinematicsNormals() const
+{
+	bKinematicsNormalsValid = true;
+	Kinematics.WalkableFloorNormal = WalkableFloorNormal();
+#if UE_SERVER
+	// Only cosmetic consumers read the smoothed floor normal.
+	Kinematics.FloorNormal = Kinematics.bIsMovingOnGround && CurrentFloor.IsWalkableFloor() ? CurrentFloor.HitResult.ImpactNormal : VerticalDirection;
+#else
+	Kinematics.FloorNormal = Kinematics.bIsMovingOnGround && CurrentFloor.IsWalkableFloor() ? GetSmoothFloorImpactNormal() : VerticalDirection;
+#endif
+}
+
+/** True if the direction turned more than the angle whose cosine is CosThreshold, or appeared or vanished. */
+static FORCEINLINE bool HasDirectionChanged(const FVector& NewDirection, const FVector& OldDirection, float CosThreshold)
+{
+	const bool bNewIsZero = NewDirection.IsNearlyZero();
+	const bool bOldIsZero = OldDirection.IsNearlyZero();
+	if (bNewIsZero || bOldIsZero)
+	{
+		return bNewIsZero != bOldIsZero;
+	}
+
+	return (NewDirection.GetUnsafeNormal() | OldDirection.GetUnsafeNormal()) < CosThreshold;
+}
+
+void UDGCharacterMovementComponent::NotifyGravityChanges()
+{
+	if (OnVerticalDirectionChanged.IsBound())
+	{
+		if (HasDirectionChanged(VerticalDirection, NotifiedVerticalDirection, FMath::Cos(FMath::DegreesToRadians(VerticalDirectionChangeThreshold))))
+		{
+			const FVector OldDirection = NotifiedVerticalDirection;
+			NotifiedVerticalDirection = VerticalDirection;
+			OnVerticalDirectionChanged.Broadcast(this, VerticalDirection, OldDirection);
+		}
+	}
+	else
+	{
+		NotifiedVerticalDirection = VerticalDirection;
+	}
+
+	const FVector CurrentGravity = Kinematics.Gravity;
+	if (OnGravityChanged.IsBound())
+	{
+		const bool bGravityChanged = FMath::Abs(CurrentGravity.Size() - NotifiedGravity.Size()) > GravityChangeMagnitudeThreshold
+			|| HasDirectionChanged(CurrentGravity, NotifiedGravity, FMath::Cos(FMath::DegreesToRadians(GravityChangeAngleThreshold)));
+		if (bGravityChanged)
+		{
+			const FVector OldGravity = NotifiedGravity;
+			NotifiedGravity = CurrentGravity;
+			OnGravityChanged.Broadcast(this, CurrentGravity, OldGravity);
+		}
+	}
+	else
+	{
+		NotifiedGravity = CurrentGravity;
+	}
+
+	if (OnWalkableNormalChanged.IsBound())
+	{
+		const FVector WalkableNormal = GetKinematics().WalkableFloorNormal;
+		if (!bNotifiedWalkableNormalValid)
+		{
+			// Listening just started, so there is no earlier normal to compare with.
+			NotifiedWalkableNormal = WalkableNormal;
+			bNotifiedWalkableNormalValid = true;
+		}
+		else if (HasDirectionChanged(WalkableNormal, NotifiedWalkableNormal, FMath::Cos(FMath::DegreesToRadians(WalkableNormalChangeThreshold))))
+		{
+			const FVector OldNormal = NotifiedWalkableNormal;
+			NotifiedWalkableNormal = WalkableNormal;
+			OnWalkableNormalChanged.Broadcast(this, WalkableNormal, OldNormal);
+		}
+	}
+	else
+	{
+		// Not evaluated without listeners.
+		bNotifiedWalkableNormalValid = false;
+	}
+}
+
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Logs how much memory the dynamic gravity characters use per instance.
+ * Usage: DG.MemReport
+ */
+static void ReportDGCharacterMemory()
+{
+	int32 NumComponents = 0;
+	int32 NumComponentsWithSettings = 0;
+	SIZE_T ComponentBytes = 0;
+	TSet<const UDGMovementSettings*> SharedSettings;
+
+	for (TObjectIterator<UDGCharacterMovementComponent> It; It; ++It)
+	{
+		if (It->IsTemplate())
+		{
+			continue;
+		}
+
+		++NumComponents;
+		ComponentBytes += It->GetClass()->GetStructureSize() + It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+		if (It->MovementSettings != NULL)
+		{
+			++NumComponentsWithSettings;
+			SharedSettings.Add(It->MovementSettings);
+		}
+	}
+
+	int32 NumCharacters = 0;
+	SIZE_T CharacterBytes = 0;
+	for (TObjectIterator<ADGCharacter> It; It; ++It)
+	{
+		if (It->IsTemplate())
+		{
+			continue;
+		}
+
+		++NumCharacters;
+		CharacterBytes += It->GetClass()->GetStructureSize() + It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	UE_LOG(LogDynamicGravity, Display, TEXT("Dynamic gravity memory report"));
+	UE_LOG(LogDynamicGravity, Display, TEXT("  Native sizes: ADGCharacter %d bytes, UDGCharacterMovementComponent %d bytes"), (int32)sizeof(ADGCharacter), (int32)sizeof(UDGCharacterMovementComponent));
+	UE_LOG(LogDynamicGravity, Display, TEXT("  Characters: %d, %llu bytes (%llu per character)"), NumCharacters, (uint64)CharacterBytes, (uint64)(NumCharacters > 0 ? CharacterBytes / NumCharacters : 0));
+	UE_LOG(LogDynamicGravity, Display, TEXT("  Movement components: %d, %llu bytes (%llu per component)"), NumComponents, (uint64)ComponentBytes, (uint64)(NumComponents > 0 ? ComponentBytes / NumComponents : 0));
+	UE_LOG(LogDynamicGravity, Display, TEXT("  Components using shared settings: %d, distinct settings assets: %d"), NumComponentsWithSettings, SharedSettings.Num());
+}
+
+static FAutoConsoleCommand DGMemReportCommand(
+	TEXT("DG.MemReport"),
+	TEXT("Logs how much memory the dynamic gravity characters use per instance."),
+	FConsoleCommandDelegate::CreateStatic(&ReportDGCharacterMemory));
+
+#endif
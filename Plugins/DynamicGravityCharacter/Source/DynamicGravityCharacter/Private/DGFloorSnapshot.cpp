@@ -0,0 +1,32 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGFloorSnapshot.h"
+
+
+FHitResult FDGFloorSnapshot::ToHitResult() const
+{
+	FHitResult Hit(1.f);
+	Hit.bBlockingHit = bBlockingHit;
+	Hit.bStartPenetrating = bStartPenetrating;
+	Hit.ImpactNormal = ImpactNormal;
+	Hit.Normal = Normal;
+	Hit.ImpactPoint = ImpactPoint;
+	Hit.Location = Location;
+	Hit.Component = Component;
+	Hit.Actor = Component.IsValid() ? Component->GetOwner() : NULL;
+	Hit.BoneName = BoneName;
+	return Hit;
+}
+
+FFindFloorResult FDGFloorSnapshot::ToFloorResult() const
+{
+	FFindFloorResult Floor;
+	Floor.HitResult = ToHitResult();
+	Floor.FloorDist = FloorDist;
+	Floor.LineDist = LineDist;
+	Floor.bBlockingHit = bBlockingHit;
+	Floor.bWalkableFloor = bWalkableFloor;
+	Floor.bLineTrace = bLineTrace;
+	return Floor;
+}
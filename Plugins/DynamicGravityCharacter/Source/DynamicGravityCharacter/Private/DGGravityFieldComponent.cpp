@@ -0,0 +1,75 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGGravityFieldComponent.h"
+#include "DGGravitySubsystem.h"
+
+#include "Engine/World.h"
+
+
+UDGGravityFieldComponent::UDGGravityFieldComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	FieldType = EGravityFieldType::GFT_Point;
+	Strength = 980.f;
+	Radius = 0.f;
+	SurfaceRadius = 1000.f;
+	bInverseSquareFalloff = false;
+}
+
+FVector UDGGravityFieldComponent::SampleGravity(const FVector& Location) const
+{
+	const FVector Center = GetComponentLocation();
+	const FVector ToCenter = Center - Location;
+	const float DistSquared = ToCenter.SizeSquared();
+
+	if (Radius > 0.f && DistSquared > FMath::Square(Radius))
+	{
+		return FVector::ZeroVector;
+	}
+
+	if (FieldType == EGravityFieldType::GFT_Directional)
+	{
+		return -GetUpVector() * Strength;
+	}
+
+	if (DistSquared <= SMALL_NUMBER)
+	{
+		return FVector::ZeroVector;
+	}
+
+	float Acceleration = Strength;
+	if (bInverseSquareFalloff && DistSquared > FMath::Square(SurfaceRadius))
+	{
+		Acceleration *= FMath::Square(SurfaceRadius) / DistSquared;
+	}
+
+	return ToCenter * (FMath::InvSqrt(DistSquared) * Acceleration);
+}
+
+void UDGGravityFieldComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (UWorld* World = GetWorld())
+	{
+		if (UDGGravitySubsystem* GravitySubsystem = World->GetSubsystem<UDGGravitySubsystem>())
+		{
+			GravitySubsystem->RegisterField(this);
+		}
+	}
+}
+
+void UDGGravityFieldComponent::OnUnregister()
+{
+	if (UWorld* World = GetWorld())
+	{
+		if (UDGGravitySubsystem* GravitySubsystem = World->GetSubsystem<UDGGravitySubsystem>())
+		{
+			GravitySubsystem->UnregisterField(this);
+		}
+	}
+
+	Super::OnUnregister();
+}
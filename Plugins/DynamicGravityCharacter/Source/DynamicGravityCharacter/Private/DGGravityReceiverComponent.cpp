@@ -0,0 +1,227 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGGravityReceiverComponent.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGGravitySubsystem.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+
+UDGGravityReceiverComponent::UDGGravityReceiverComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	DynamicGravity = FVector::ZeroVector;
+	bIgnoreWorldGravityIfDynamicGravityIsNotZero = false;
+	GravityScale = 1.f;
+	TargetPrimitive = NULL;
+	bReceiving = false;
+}
+
+void UDGGravityReceiverComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	// Registered again after play started, like when the owner is rebuilt.
+	if (HasBegunPlay())
+	{
+		StartReceiving();
+	}
+}
+
+void UDGGravityReceiverComponent::OnUnregister()
+{
+	StopReceiving();
+
+	Super::OnUnregister();
+}
+
+void UDGGravityReceiverComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	StartReceiving();
+}
+
+void UDGGravityReceiverComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopReceiving();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UDGGravityReceiverComponent::StartReceiving()
+{
+	UWorld* World = GetWorld();
+	if (bReceiving || World == NULL || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	if (UDGGravitySubsystem* GravitySubsystem = World->GetSubsystem<UDGGravitySubsystem>())
+	{
+		GravitySubsystem->RegisterReceiver(this);
+		DisableWorldGravity();
+		bReceiving = true;
+	}
+}
+
+void UDGGravityReceiverComponent::StopReceiving()
+{
+	if (!bReceiving)
+	{
+		return;
+	}
+
+	bReceiving = false;
+	if (UDGGravitySubsystem* GravitySubsystem = GetWorld()->GetSubsystem<UDGGravitySubsystem>())
+	{
+		GravitySubsystem->UnregisterReceiver(this);
+	}
+	RestoreWorldGravity();
+}
+
+FBodyInstance* UDGGravityReceiverComponent::GetBody(UPrimitiveComponent* Primitive, int32 BodyIndex)
+{
+	if (BodyIndex == INDEX_NONE)
+	{
+		return Primitive->GetBodyInstance();
+	}
+
+	const USkeletalMeshComponent* SkeletalMesh = Cast<USkeletalMeshComponent>(Primitive);
+	return SkeletalMesh != NULL && SkeletalMesh->Bodies.IsValidIndex(BodyIndex) ? SkeletalMesh->Bodies[BodyIndex] : NULL;
+}
+
+bool UDGGravityReceiverComponent::TakeOverBodyGravity(UPrimitiveComponent* Primitive, int32 BodyIndex, FBodyInstance* Body)
+{
+	const FBodyKey Key(Primitive, BodyIndex);
+	if (const bool* bSavedEnabled = SavedGravityEnabled.Find(Key))
+	{
+		// A body rebuilt with its setup flag, as a new ragdoll, is disabled again.
+		if (*bSavedEnabled && Body->bEnableGravity)
+		{
+			Body->SetEnableGravity(false);
+		}
+		return *bSavedEnabled;
+	}
+
+	const bool bEnabled = Body->bEnableGravity;
+	SavedGravityEnabled.Add(Key, bEnabled);
+	if (bEnabled)
+	{
+		Body->SetEnableGravity(false);
+	}
+	return bEnabled;
+}
+
+void UDGGravityReceiverComponent::DisableWorldGravity()
+{
+	auto DisablePrimitive = [this](UPrimitiveComponent* Primitive)
+	{
+		// A skeletal mesh has a body per bone, each with its own flag.
+		if (USkeletalMeshComponent* SkeletalMesh = Cast<USkeletalMeshComponent>(Primitive))
+		{
+			for (int32 BodyIndex = 0; BodyIndex < SkeletalMesh->Bodies.Num(); ++BodyIndex)
+			{
+				if (FBodyInstance* Body = SkeletalMesh->Bodies[BodyIndex])
+				{
+					TakeOverBodyGravity(Primitive, BodyIndex, Body);
+				}
+			}
+			return;
+		}
+
+		if (FBodyInstance* Body = Primitive->GetBodyInstance())
+		{
+			TakeOverBodyGravity(Primitive, INDEX_NONE, Body);
+		}
+	};
+
+	SavedGravityEnabled.Reset();
+	if (TargetPrimitive != NULL)
+	{
+		DisablePrimitive(TargetPrimitive);
+		return;
+	}
+
+	if (const AActor* Owner = GetOwner())
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(Owner);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			DisablePrimitive(Primitive);
+		}
+	}
+}
+
+void UDGGravityReceiverComponent::RestoreWorldGravity()
+{
+	for (const TPair<FBodyKey, bool>& Saved : SavedGravityEnabled)
+	{
+		UPrimitiveComponent* Primitive = Saved.Key.Key.Get();
+		FBodyInstance* Body = Primitive != NULL ? GetBody(Primitive, Saved.Key.Value) : NULL;
+		if (Body != NULL && Body->bEnableGravity != Saved.Value)
+		{
+			Body->SetEnableGravity(Saved.Value);
+		}
+	}
+	SavedGravityEnabled.Reset();
+}
+
+void UDGGravityReceiverComponent::GatherSimulatingBodies(TArray<FBodyInstance*>& OutBodies)
+{
+	auto GatherPrimitive = [this, &OutBodies](UPrimitiveComponent* Primitive)
+	{
+		if (Primitive == NULL || !Primitive->IsSimulatingPhysics())
+		{
+			return;
+		}
+
+		// A ragdoll has a body per bone.
+		if (USkeletalMeshComponent* SkeletalMesh = Cast<USkeletalMeshComponent>(Primitive))
+		{
+			for (int32 BodyIndex = 0; BodyIndex < SkeletalMesh->Bodies.Num(); ++BodyIndex)
+			{
+				FBodyInstance* Body = SkeletalMesh->Bodies[BodyIndex];
+				if (Body != NULL && Body->IsInstanceSimulatingPhysics() && TakeOverBodyGravity(Primitive, BodyIndex, Body))
+				{
+					OutBodies.Add(Body);
+				}
+			}
+			return;
+		}
+
+		FBodyInstance* Body = Primitive->GetBodyInstance();
+		if (Body != NULL && Body->IsInstanceSimulatingPhysics() && TakeOverBodyGravity(Primitive, INDEX_NONE, Body))
+		{
+			OutBodies.Add(Body);
+		}
+	};
+
+	if (TargetPrimitive != NULL)
+	{
+		GatherPrimitive(TargetPrimitive);
+		return;
+	}
+
+	if (const AActor* Owner = GetOwner())
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(Owner);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			GatherPrimitive(Primitive);
+		}
+	}
+}
+
+FVector UDGGravityReceiverComponent::CombineGravity(const FVector& FieldGravity) const
+{
+	const FVector WorldGravity = GetWorld()->GetGravityZ() * UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+	const FVector Dynamic = DynamicGravity + FieldGravity;
+	const FVector Combined = (bIgnoreWorldGravityIfDynamicGravityIsNotZero && !Dynamic.Equals(FVector::ZeroVector)) ? Dynamic : WorldGravity + Dynamic;
+	return Combined * GravityScale;
+}
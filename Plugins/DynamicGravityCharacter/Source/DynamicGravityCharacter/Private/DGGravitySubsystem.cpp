@@ -0,0 +1,235 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGGravitySubsystem.h"
+#include "DGGravityReceiverComponent.h"
+#include "DGProjectileMovementComponent.h"
+
+#include "Engine/World.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsPublic.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("DG SampleGravityBatch"), STAT_DGSampleGravityBatch, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("DG UpdateProjectileGravity"), STAT_DGUpdateProjectileGravity, STATGROUP_Character);
+DECLARE_CYCLE_STAT(TEXT("DG ApplyReceiverGravity"), STAT_DGApplyReceiverGravity, STATGROUP_Character);
+
+
+void UDGGravitySubsystem::RegisterField(UDGGravityFieldComponent* Field)
+{
+	Fields.AddUnique(Field);
+}
+
+void UDGGravitySubsystem::UnregisterField(UDGGravityFieldComponent* Field)
+{
+	Fields.RemoveSwap(Field);
+}
+
+FVector UDGGravitySubsystem::SampleGravity(const FVector& Location) const
+{
+	FVector Gravity = FVector::ZeroVector;
+	for (const UDGGravityFieldComponent* Field : Fields)
+	{
+		if (Field != NULL)
+		{
+			Gravity += Field->SampleGravity(Location);
+		}
+	}
+
+	return Gravity;
+}
+
+UDGGravityFieldComponent* UDGGravitySubsystem::FindDominantPointField(const FVector& Location) const
+{
+	UDGGravityFieldComponent* DominantField = NULL;
+	float DominantGravitySquared = 0.f;
+	for (UDGGravityFieldComponent* Field : Fields)
+	{
+		if (Field == NULL || Field->FieldType != EGravityFieldType::GFT_Point)
+		{
+			continue;
+		}
+
+		const float GravitySquared = Field->SampleGravity(Location).SizeSquared();
+		if (GravitySquared > DominantGravitySquared)
+		{
+			DominantField = Field;
+			DominantGravitySquared = GravitySquared;
+		}
+	}
+
+	return DominantField;
+}
+
+void UDGGravitySubsystem::SampleGravityBatch(const FVector* Locations, int32 Num, FVector* OutGravity) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_DGSampleGravityBatch);
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		OutGravity[Index] = FVector::ZeroVector;
+	}
+
+	for (const UDGGravityFieldComponent* Field : Fields)
+	{
+		if (Field == NULL)
+		{
+			continue;
+		}
+
+		const FVector FieldLocation = Field->GetComponentLocation();
+		const VectorRegister Center = VectorLoadFloat3_W0(&FieldLocation);
+		const float RadiusSquared = Field->Radius > 0.f ? FMath::Square(Field->Radius) : MAX_flt;
+
+		if (Field->FieldType == EGravityFieldType::GFT_Directional)
+		{
+			const FVector FieldGravity = -Field->GetUpVector() * Field->Strength;
+			for (int32 Index = 0; Index < Num; ++Index)
+			{
+				const VectorRegister ToCenter = VectorSubtract(Center, VectorLoadFloat3_W0(&Locations[Index]));
+				if (VectorGetComponent(VectorDot3(ToCenter, ToCenter), 0) <= RadiusSquared)
+				{
+					OutGravity[Index] += FieldGravity;
+				}
+			}
+			continue;
+		}
+
+		const float Strength = Field->Strength;
+		const float SurfaceRadiusSquared = FMath::Square(Field->SurfaceRadius);
+		const bool bInverseSquareFalloff = Field->bInverseSquareFalloff;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const VectorRegister ToCenter = VectorSubtract(Center, VectorLoadFloat3_W0(&Locations[Index]));
+			const float DistSquared = VectorGetComponent(VectorDot3(ToCenter, ToCenter), 0);
+			if (DistSquared > RadiusSquared || DistSquared <= SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			float Acceleration = Strength;
+			if (bInverseSquareFalloff && DistSquared > SurfaceRadiusSquared)
+			{
+				Acceleration *= SurfaceRadiusSquared / DistSquared;
+			}
+
+			FVector Gravity;
+			VectorStoreFloat3(VectorMultiply(ToCenter, VectorSetFloat1(FMath::InvSqrt(DistSquared) * Acceleration)), &Gravity);
+			OutGravity[Index] += Gravity;
+		}
+	}
+}
+
+void UDGGravitySubsystem::RegisterProjectile(UDGProjectileMovementComponent* Projectile)
+{
+	Projectiles.AddUnique(Projectile);
+}
+
+void UDGGravitySubsystem::UnregisterProjectile(UDGProjectileMovementComponent* Projectile)
+{
+	Projectiles.RemoveSwap(Projectile);
+}
+
+void UDGGravitySubsystem::UpdateProjectileGravity(float DeltaTime)
+{
+	if (ProjectileGravityFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_DGUpdateProjectileGravity);
+	ProjectileGravityFrame = GFrameCounter;
+
+	Projectiles.RemoveAllSwap([](const TWeakObjectPtr<UDGProjectileMovementComponent>& Projectile) { return !Projectile.IsValid(); }, false);
+
+	const int32 Num = Projectiles.Num();
+	ProjectileLocations.SetNumUninitialized(Num * 2, false);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const UDGProjectileMovementComponent* Projectile = Projectiles[Index].Get();
+		const FVector Location = Projectile->UpdatedComponent != NULL ? Projectile->UpdatedComponent->GetComponentLocation() : FVector::ZeroVector;
+		ProjectileLocations[Index] = Location;
+		ProjectileLocations[Num + Index] = Location + Projectile->Velocity * DeltaTime;
+	}
+
+	ProjectileGravity.SetNumUninitialized(Num * 2, false);
+	SampleGravityBatch(ProjectileLocations.GetData(), Num * 2, ProjectileGravity.GetData());
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		Projectiles[Index]->SetFrameGravity(ProjectileLocations[Index], ProjectileGravity[Index], ProjectileLocations[Num + Index], ProjectileGravity[Num + Index]);
+	}
+}
+
+void UDGGravitySubsystem::RegisterReceiver(UDGGravityReceiverComponent* Receiver)
+{
+	Receivers.AddUnique(Receiver);
+
+	if (!PhysScenePreTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScenePreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UDGGravitySubsystem::ApplyReceiverGravity);
+		}
+	}
+}
+
+void UDGGravitySubsystem::UnregisterReceiver(UDGGravityReceiverComponent* Receiver)
+{
+	Receivers.RemoveSwap(Receiver);
+}
+
+void UDGGravitySubsystem::Deinitialize()
+{
+	if (PhysScenePreTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+		}
+		PhysScenePreTickHandle.Reset();
+	}
+
+	Receivers.Reset();
+
+	Super::Deinitialize();
+}
+
+void UDGGravitySubsystem::ApplyReceiverGravity(FPhysScene* PhysScene, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DGApplyReceiverGravity);
+
+	Receivers.RemoveAllSwap([](const TWeakObjectPtr<UDGGravityReceiverComponent>& Receiver) { return !Receiver.IsValid(); }, false);
+
+	ReceiverBodies.Reset();
+	ReceiverBodyOwners.Reset();
+	for (int32 ReceiverIndex = 0; ReceiverIndex < Receivers.Num(); ++ReceiverIndex)
+	{
+		const int32 FirstBody = ReceiverBodies.Num();
+		Receivers[ReceiverIndex]->GatherSimulatingBodies(ReceiverBodies);
+		for (int32 Index = FirstBody; Index < ReceiverBodies.Num(); ++Index)
+		{
+			ReceiverBodyOwners.Add(ReceiverIndex);
+		}
+	}
+
+	const int32 Num = ReceiverBodies.Num();
+	if (Num == 0)
+	{
+		return;
+	}
+
+	ReceiverLocations.SetNumUninitialized(Num, false);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		ReceiverLocations[Index] = ReceiverBodies[Index]->GetCOMPosition();
+	}
+
+	ReceiverGravity.SetNumUninitialized(Num, false);
+	SampleGravityBatch(ReceiverLocations.GetData(), Num, ReceiverGravity.GetData());
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		ReceiverBodies[Index]->AddForce(Receivers[ReceiverBodyOwners[Index]]->CombineGravity(ReceiverGravity[Index]), true, true);
+	}
+}
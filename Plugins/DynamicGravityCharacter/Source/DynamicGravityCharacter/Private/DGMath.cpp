@@ -0,0 +1,210 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGMath.h"
+#include "DynamicGravityCharacter.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+
+void FDGMath::MakeBasisFromZX(const FVector& ZAxis, const FVector& XAxis, FVector& OutX, FVector& OutY, FVector& OutZ)
+{
+	const VectorRegister NewZ = SafeNormalize(VectorLoadFloat3_W0(&ZAxis));
+	VectorRegister Norm = SafeNormalize(VectorLoadFloat3_W0(&XAxis));
+
+	// Same fallback of FRotationMatrix::MakeFromZX when the axes are parallel.
+	if (FMath::Abs(VectorGetComponent(VectorDot3(NewZ, Norm), 0)) > (1.f - KINDA_SMALL_NUMBER))
+	{
+		Norm = (FMath::Abs(VectorGetComponent(NewZ, 2)) < (1.f - KINDA_SMALL_NUMBER)) ? MakeVectorRegister(0.f, 0.f, 1.f, 0.f) : MakeVectorRegister(1.f, 0.f, 0.f, 0.f);
+	}
+
+	const VectorRegister NewY = SafeNormalize(VectorCross(NewZ, Norm));
+	const VectorRegister NewX = VectorCross(NewY, NewZ);
+
+	VectorStoreFloat3(NewX, &OutX);
+	VectorStoreFloat3(NewY, &OutY);
+	VectorStoreFloat3(NewZ, &OutZ);
+}
+
+FQuat FDGMath::MakeQuatFromZX(const FVector& ZAxis, const FVector& XAxis)
+{
+	FVector X, Y, Z;
+	MakeBasisFromZX(ZAxis, XAxis, X, Y, Z);
+	return FMatrix(X, Y, Z, FVector::ZeroVector).ToQuat();
+}
+
+FQuat FDGMath::Slerp(const FQuat& A, const FQuat& B, float Alpha)
+{
+	const VectorRegister QuatA = VectorLoadAligned(&A);
+	VectorRegister QuatB = VectorLoadAligned(&B);
+
+	float CosOmega = VectorGetComponent(VectorDot4(QuatA, QuatB), 0);
+
+	// Take the shortest path.
+	if (CosOmega < 0.f)
+	{
+		QuatB = VectorNegate(QuatB);
+		CosOmega = -CosOmega;
+	}
+
+	float ScaleA = 1.f - Alpha;
+	float ScaleB = Alpha;
+	if (CosOmega < 0.9999f)
+	{
+		const float Omega = FMath::Acos(CosOmega);
+		const float InvSin = 1.f / FMath::Sin(Omega);
+		ScaleA = FMath::Sin(ScaleA * Omega) * InvSin;
+		ScaleB = FMath::Sin(ScaleB * Omega) * InvSin;
+	}
+
+	VectorRegister Result = VectorMultiplyAdd(QuatA, VectorSetFloat1(ScaleA), VectorMultiply(QuatB, VectorSetFloat1(ScaleB)));
+	Result = VectorMultiply(Result, VectorReciprocalSqrtAccurate(VectorDot4(Result, Result)));
+
+	FQuat Out;
+	VectorStoreAligned(Result, &Out);
+	return Out;
+}
+
+void FDGMath::DecomposeBatch(const FVector* Vectors, const FVector* Directions, int32 Num, FVector* OutVertical, FVector* OutHorizontal)
+{
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vectors[Index]);
+		const VectorRegister N = VectorLoadFloat3_W0(&Directions[Index]);
+		const VectorRegister Vertical = VectorMultiply(N, VectorDot3(V, N));
+		VectorStoreFloat3(Vertical, &OutVertical[Index]);
+		VectorStoreFloat3(VectorSubtract(V, Vertical), &OutHorizontal[Index]);
+	}
+}
+
+void FDGMath::DecomposeBatch(const FVector* Vectors, const FVector& Direction, int32 Num, FVector* OutVertical, FVector* OutHorizontal)
+{
+	const VectorRegister N = VectorLoadFloat3_W0(&Direction);
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vectors[Index]);
+		const VectorRegister Vertical = VectorMultiply(N, VectorDot3(V, N));
+		VectorStoreFloat3(Vertical, &OutVertical[Index]);
+		VectorStoreFloat3(VectorSubtract(V, Vertical), &OutHorizontal[Index]);
+	}
+}
+
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Compares the kernels against the scalar FVector code they replace.
+ * Usage: DG.Math.Benchmark [NumVectors] [NumRuns]
+ */
+static void BenchmarkDGMath(const TArray<FString>& Args)
+{
+	const int32 Num = Args.Num() > 0 ? FMath::Max(8, FCString::Atoi(*Args[0])) : 4096;
+	const int32 Runs = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1000;
+
+	FRandomStream Stream(1234);
+	TArray<FVector> Vectors, Directions, Vertical, Horizontal;
+	Vectors.SetNumUninitialized(Num);
+	Directions.SetNumUninitialized(Num);
+	Vertical.SetNumUninitialized(Num);
+	Horizontal.SetNumUninitialized(Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		Vectors[Index] = Stream.GetUnitVector() * Stream.FRandRange(0.f, 1000.f);
+		Directions[Index] = Stream.GetUnitVector();
+	}
+
+	auto Measure = [Runs](const TCHAR* Name, TFunctionRef<void()> Kernel)
+	{
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Run = 0; Run < Runs; ++Run)
+		{
+			Kernel();
+		}
+		const double Elapsed = FPlatformTime::Seconds() - Start;
+		UE_LOG(LogDynamicGravity, Display, TEXT("%-32s %10.3f ms"), Name, Elapsed * 1000.0);
+	};
+
+	Measure(TEXT("Decompose (scalar FVector)"), [&]()
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			Vertical[Index] = Vectors[Index].ProjectOnToNormal(Directions[Index]);
+			Horizontal[Index] = Vectors[Index] - Vertical[Index];
+		}
+	});
+	Measure(TEXT("Decompose (single)"), [&]()
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			FDGMath::Decompose(Vectors[Index], Directions[Index], Vertical[Index], Horizontal[Index]);
+		}
+	});
+	Measure(TEXT("Decompose (batch)"), [&]() { FDGMath::DecomposeBatch(Vectors.GetData(), Directions.GetData(), Num, Vertical.GetData(), Horizontal.GetData()); });
+
+	Measure(TEXT("HorizontalDirection (scalar)"), [&]()
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			Horizontal[Index] = (Vectors[Index] - Vectors[Index].ProjectOnToNormal(Directions[Index])).GetSafeNormal();
+		}
+	});
+	Measure(TEXT("HorizontalDirection (kernel)"), [&]()
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			Horizontal[Index] = FDGMath::HorizontalDirection(Vectors[Index], Directions[Index]);
+		}
+	});
+
+	Measure(TEXT("MakeFromZX (FRotationMatrix)"), [&]()
+	{
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const FMatrix Matrix = FRotationMatrix::MakeFromZX(Directions[Index], Vectors[Index]);
+			Horizontal[Index] = Matrix.GetScaledAxis(EAxis::X);
+		}
+	});
+	Measure(TEXT("MakeFromZX (kernel)"), [&]()
+	{
+		FVector Y, Z;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			FDGMath::MakeBasisFromZX(Directions[Index], Vectors[Index], Horizontal[Index], Y, Z);
+		}
+	});
+
+	TArray<FQuat> Quats;
+	Quats.SetNumUninitialized(Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		Quats[Index] = FRotator(Stream.FRandRange(-180.f, 180.f), Stream.FRandRange(-180.f, 180.f), Stream.FRandRange(-180.f, 180.f)).Quaternion();
+	}
+
+	FQuat Accumulated = FQuat::Identity;
+	Measure(TEXT("Slerp (FQuat)"), [&]()
+	{
+		for (int32 Index = 1; Index < Num; ++Index)
+		{
+			Accumulated = FQuat::Slerp(Quats[Index - 1], Quats[Index], 0.3f);
+		}
+	});
+	Measure(TEXT("Slerp (kernel)"), [&]()
+	{
+		for (int32 Index = 1; Index < Num; ++Index)
+		{
+			Accumulated = FDGMath::Slerp(Quats[Index - 1], Quats[Index], 0.3f);
+		}
+	});
+
+	// Keep the results alive.
+	UE_LOG(LogDynamicGravity, Verbose, TEXT("%s %s %s"), *Vertical[Num - 1].ToString(), *Horizontal[Num - 1].ToString(), *Accumulated.ToString());
+}
+
+static FAutoConsoleCommand DGMathBenchmarkCommand(
+	TEXT("DG.Math.Benchmark"),
+	TEXT("Compares the DGMath kernels against the scalar FVector versions. Usage: DG.Math.Benchmark [NumVectors] [NumRuns]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkDGMath));
+
+#endif
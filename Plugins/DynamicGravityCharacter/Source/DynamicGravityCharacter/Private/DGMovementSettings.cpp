@@ -0,0 +1,30 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGMovementSettings.h"
+
+
+UDGMovementSettings::UDGMovementSettings()
+{
+	WalkableFloorNormalMode = UDGCharacterMovementComponent::DEFAULT_WALKABLE_FLOOR_NORMAL_MODE;
+	CustomWalkableFloorNormal = UDGCharacterMovementComponent::DEFAULT_CUSTOM_WALKABLE_FLOOR_NORMAL;
+
+	JumpDirectionMode = UDGCharacterMovementComponent::DEFAULT_JUMP_DIRECTION_MODE;
+	CustomJumpDirection = UDGCharacterMovementComponent::DEFAULT_CUSTOM_JUMP_DIRECTION;
+
+	RotationAdjustIntensity = UDGCharacterMovementComponent::DEFAULT_LERP_ROTATION_RATE;
+	PhysicsRotationVerticalDirectionMode = UDGCharacterMovementComponent::DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE;
+	CustomPhysicsRotationVerticalDirection = UDGCharacterMovementComponent::DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION;
+
+	bIgnoreWorldGravityIfDynamicGravityIsNotZero = false;
+}
+
+#if WITH_EDITOR
+void UDGMovementSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	CustomWalkableFloorNormal = CustomWalkableFloorNormal.GetSafeNormal();
+	CustomJumpDirection = CustomJumpDirection.GetSafeNormal();
+}
+#endif
@@ -0,0 +1,174 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGProjectileMovementComponent.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGGravitySubsystem.h"
+
+#include "Engine/World.h"
+
+
+UDGProjectileMovementComponent::UDGProjectileMovementComponent()
+{
+	DynamicGravity = FVector::ZeroVector;
+	bSampleGravityFields = false;
+	bIgnoreWorldGravityIfDynamicGravityIsNotZero = false;
+
+	bAdaptiveSubstepping = true;
+	MaxTurnAnglePerSubstep = 5.f;
+	MinAdaptiveTimeStep = 0.0166f;
+	MaxAdaptiveTimeStep = 0.1f;
+
+	GravitySubsystem = NULL;
+	FrameGravityStartLocation = FVector::ZeroVector;
+	FrameGravityStart = FVector::ZeroVector;
+	FrameGravityEndLocation = FVector::ZeroVector;
+	FrameGravityEnd = FVector::ZeroVector;
+}
+
+void UDGProjectileMovementComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	UWorld* World = GetWorld();
+	if (World != NULL && World->IsGameWorld())
+	{
+		GravitySubsystem = World->GetSubsystem<UDGGravitySubsystem>();
+		if (GravitySubsystem != NULL)
+		{
+			GravitySubsystem->RegisterProjectile(this);
+		}
+	}
+}
+
+void UDGProjectileMovementComponent::OnUnregister()
+{
+	if (GravitySubsystem != NULL)
+	{
+		GravitySubsystem->UnregisterProjectile(this);
+		GravitySubsystem = NULL;
+	}
+
+	Super::OnUnregister();
+}
+
+void UDGProjectileMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The batch of this frame may have run before the projectile spawned.
+	SampleFrameGravity();
+}
+
+void UDGProjectileMovementComponent::SampleFrameGravity()
+{
+	if (!bSampleGravityFields || GravitySubsystem == NULL || UpdatedComponent == NULL)
+	{
+		return;
+	}
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector FieldGravity = GravitySubsystem->SampleGravity(Location);
+	SetFrameGravity(Location, FieldGravity, Location, FieldGravity);
+}
+
+void UDGProjectileMovementComponent::SetFrameGravity(const FVector& StartLocation, const FVector& StartGravity, const FVector& EndLocation, const FVector& EndGravity)
+{
+	FrameGravityStartLocation = StartLocation;
+	FrameGravityStart = StartGravity;
+	FrameGravityEndLocation = EndLocation;
+	FrameGravityEnd = EndGravity;
+}
+
+FVector UDGProjectileMovementComponent::GetDynamicGravity() const
+{
+	if (!bSampleGravityFields || UpdatedComponent == NULL)
+	{
+		return DynamicGravity;
+	}
+
+	// Interpolate by the progress of the projectile along the predicted move of this frame.
+	const FVector FrameMove = FrameGravityEndLocation - FrameGravityStartLocation;
+	const float FrameMoveSizeSquared = FrameMove.SizeSquared();
+	const float Alpha = FrameMoveSizeSquared > KINDA_SMALL_NUMBER ? FMath::Clamp(((UpdatedComponent->GetComponentLocation() - FrameGravityStartLocation) | FrameMove) / FrameMoveSizeSquared, 0.f, 1.f) : 0.f;
+
+	return DynamicGravity + FMath::Lerp(FrameGravityStart, FrameGravityEnd, Alpha);
+}
+
+FVector UDGProjectileMovementComponent::Gravity() const
+{
+	if (!ShouldApplyGravity())
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FVector WorldGravity = UMovementComponent::GetGravityZ() * UDGCharacterMovementComponent::DEFAULT_GRAVITY_DIRECTION;
+	const FVector Dynamic = GetDynamicGravity();
+	const FVector Combined = (bIgnoreWorldGravityIfDynamicGravityIsNotZero && !Dynamic.Equals(FVector::ZeroVector)) ? Dynamic : WorldGravity + Dynamic;
+	return Combined * ProjectileGravityScale;
+}
+
+FVector UDGProjectileMovementComponent::ComputeAcceleration(const FVector& InVelocity, float DeltaTime) const
+{
+	// Replace the world Z gravity added by the base class.
+	FVector Acceleration = Super::ComputeAcceleration(InVelocity, DeltaTime);
+	Acceleration.Z -= GetGravityZ();
+	return Acceleration + Gravity();
+}
+
+void UDGProjectileMovementComponent::UpdateAdaptiveTimeStep(float DeltaTime)
+{
+	const float Speed = Velocity.Size();
+	const FVector GravityStart = FrameGravityStart + DynamicGravity;
+	const FVector GravityEnd = FrameGravityEnd + DynamicGravity;
+
+	// Turn rate of the velocity, from the gravity perpendicular to it.
+	float TurnRate = 0.f;
+	if (Speed > KINDA_SMALL_NUMBER)
+	{
+		const FVector Direction = Velocity / Speed;
+		const FVector CurrentGravity = Gravity();
+		TurnRate = (CurrentGravity - Direction * (CurrentGravity | Direction)).Size() / Speed;
+	}
+
+	// Turn rate of the gravity direction along the predicted move.
+	const FVector GravityStartNormal = GravityStart.GetSafeNormal();
+	const FVector GravityEndNormal = GravityEnd.GetSafeNormal();
+	if (DeltaTime > SMALL_NUMBER && !GravityStartNormal.IsZero() && !GravityEndNormal.IsZero())
+	{
+		TurnRate = FMath::Max(TurnRate, FMath::Acos(FMath::Clamp(GravityStartNormal | GravityEndNormal, -1.f, 1.f)) / DeltaTime);
+	}
+
+	const float MaxTurnAngle = FMath::DegreesToRadians(MaxTurnAnglePerSubstep);
+	const float TimeStep = TurnRate > SMALL_NUMBER ? MaxTurnAngle / TurnRate : MaxAdaptiveTimeStep;
+
+	bForceSubStepping = true;
+	MaxSimulationTimeStep = FMath::Clamp(TimeStep, MinAdaptiveTimeStep, FMath::Max(MinAdaptiveTimeStep, MaxAdaptiveTimeStep));
+	MaxSimulationIterations = FMath::Clamp(FMath::Max(MaxSimulationIterations, FMath::CeilToInt(DeltaTime / MaxSimulationTimeStep)), 1, 25);
+}
+
+void UDGProjectileMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (bSampleGravityFields && GravitySubsystem != NULL)
+	{
+		GravitySubsystem->UpdateProjectileGravity(DeltaTime);
+	}
+
+	if (!bAdaptiveSubstepping)
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	// The adaptive substep only lasts for this tick, so the designer settings are kept.
+	const bool bSavedForceSubStepping = bForceSubStepping;
+	const float SavedMaxSimulationTimeStep = MaxSimulationTimeStep;
+	const int32 SavedMaxSimulationIterations = MaxSimulationIterations;
+
+	UpdateAdaptiveTimeStep(DeltaTime);
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	bForceSubStepping = bSavedForceSubStepping;
+	MaxSimulationTimeStep = SavedMaxSimulationTimeStep;
+	MaxSimulationIterations = SavedMaxSimulationIterations;
+}
@@ -0,0 +1,119 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGRootMotionSource.h"
+#include "DGMath.h"
+
+#include "Curves/CurveFloat.h"
+#include "Engine/NetSerialization.h"
+
+
+FDGRootMotionSource_GravityJumpForce::FDGRootMotionSource_GravityJumpForce()
+	: UpVector(FVector::UpVector)
+	, MinimumLandedTriggerTime(0.f)
+{
+}
+
+FVector FDGRootMotionSource_GravityJumpForce::GetGravityRelativeLocation(float MoveFraction) const
+{
+	// The same path as FRootMotionSource_JumpForce, in the basis of UpVector and the facing direction.
+	FVector Forward;
+	FVector Right;
+	FVector Up;
+	FDGMath::MakeBasisFromZX(UpVector, Rotation.Vector(), Forward, Right, Up);
+
+	const FVector RelativeLocationFacingSpace = FVector(MoveFraction * Distance, 0.f, 0.f) + GetPathOffset(MoveFraction);
+	return Forward * RelativeLocationFacingSpace.X + Right * RelativeLocationFacingSpace.Y + Up * RelativeLocationFacingSpace.Z;
+}
+
+FRootMotionSource* FDGRootMotionSource_GravityJumpForce::Clone() const
+{
+	return new FDGRootMotionSource_GravityJumpForce(*this);
+}
+
+bool FDGRootMotionSource_GravityJumpForce::Matches(const FRootMotionSource* Other) const
+{
+	if (!FRootMotionSource_JumpForce::Matches(Other))
+	{
+		return false;
+	}
+
+	// FRootMotionSource::Matches has already verified that the script structs match.
+	const FDGRootMotionSource_GravityJumpForce* OtherCast = static_cast<const FDGRootMotionSource_GravityJumpForce*>(Other);
+	return UpVector.Equals(OtherCast->UpVector, KINDA_SMALL_NUMBER)
+		&& FMath::IsNearlyEqual(MinimumLandedTriggerTime, OtherCast->MinimumLandedTriggerTime, SMALL_NUMBER);
+}
+
+bool FDGRootMotionSource_GravityJumpForce::MatchesAndHasSameState(const FRootMotionSource* Other) const
+{
+	// Matches() covers the jump parameters, and the base the time and status.
+	return FRootMotionSource_JumpForce::MatchesAndHasSameState(Other) && Matches(Other);
+}
+
+void FDGRootMotionSource_GravityJumpForce::PrepareRootMotion(float SimulationTime, float MovementTickTime, const ACharacter& Character, const UCharacterMovementComponent& MoveComponent)
+{
+	RootMotionParams.Clear();
+
+	// Landed before MinimumLandedTriggerTime, the jump ends once the time is reached on the ground.
+	if (bDisableTimeout && GetTime() >= MinimumLandedTriggerTime && MoveComponent.IsMovingOnGround())
+	{
+		Status.SetFlag(ERootMotionSourceStatusFlags::Finished);
+		return;
+	}
+
+	if (Duration > SMALL_NUMBER && MovementTickTime > SMALL_NUMBER)
+	{
+		float CurrentTimeFraction = GetTime() / Duration;
+		float TargetTimeFraction = (GetTime() + SimulationTime) / Duration;
+
+		// Past the duration, keep the velocity of the end of the jump.
+		if (TargetTimeFraction > 1.f)
+		{
+			const float TimeFractionPastAllowable = TargetTimeFraction - 1.f;
+			TargetTimeFraction -= TimeFractionPastAllowable;
+			CurrentTimeFraction -= TimeFractionPastAllowable;
+		}
+
+		float CurrentMoveFraction = CurrentTimeFraction;
+		float TargetMoveFraction = TargetTimeFraction;
+
+		if (TimeMappingCurve != NULL)
+		{
+			float MinCurveTime;
+			float MaxCurveTime;
+			TimeMappingCurve->GetTimeRange(MinCurveTime, MaxCurveTime);
+			CurrentMoveFraction = TimeMappingCurve->GetFloatValue(FMath::Lerp(MinCurveTime, MaxCurveTime, CurrentMoveFraction));
+			TargetMoveFraction = TimeMappingCurve->GetFloatValue(FMath::Lerp(MinCurveTime, MaxCurveTime, TargetMoveFraction));
+		}
+
+		const FVector CurrentRelativeLocation = GetGravityRelativeLocation(CurrentMoveFraction);
+		const FVector TargetRelativeLocation = GetGravityRelativeLocation(TargetMoveFraction);
+
+		const FVector Force = (TargetRelativeLocation - CurrentRelativeLocation) / MovementTickTime;
+		RootMotionParams.Set(FTransform(Force));
+	}
+
+	SetTime(GetTime() + SimulationTime);
+}
+
+bool FDGRootMotionSource_GravityJumpForce::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	if (!FRootMotionSource_JumpForce::NetSerialize(Ar, Map, bOutSuccess))
+	{
+		return false;
+	}
+
+	bOutSuccess &= SerializeFixedVector<1, 16>(UpVector, Ar);
+	Ar << MinimumLandedTriggerTime;
+	return true;
+}
+
+UScriptStruct* FDGRootMotionSource_GravityJumpForce::GetScriptStruct() const
+{
+	return FDGRootMotionSource_GravityJumpForce::StaticStruct();
+}
+
+FString FDGRootMotionSource_GravityJumpForce::ToSimpleString() const
+{
+	return FString::Printf(TEXT("[ID:%u]FDGRootMotionSource_GravityJumpForce %s"), LocalID, *InstanceName.GetPlainNameString());
+}
@@ -0,0 +1,198 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGSmoothNormalsUserData.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+
+
+UDGSmoothNormalsUserData::UDGSmoothNormalsUserData()
+{
+	CreaseAngle = 60.f;
+}
+
+bool UDGSmoothNormalsUserData::GetSmoothNormal(const FHitResult& Hit, FVector& OutNormal)
+{
+	const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Hit.Component.Get());
+	if (MeshComponent == NULL || Hit.FaceIndex == INDEX_NONE || MeshComponent->GetStaticMesh() == NULL)
+	{
+		return false;
+	}
+
+	const UDGSmoothNormalsUserData* SmoothNormals = NULL;
+	if (const TArray<UAssetUserData*>* UserDataArray = MeshComponent->GetStaticMesh()->GetAssetUserDataArray())
+	{
+		for (const UAssetUserData* UserData : *UserDataArray)
+		{
+			SmoothNormals = Cast<UDGSmoothNormalsUserData>(UserData);
+			if (SmoothNormals != NULL)
+			{
+				break;
+			}
+		}
+	}
+
+	if (SmoothNormals == NULL)
+	{
+		return false;
+	}
+
+	FTransform MeshToWorld = MeshComponent->GetComponentTransform();
+	const UInstancedStaticMeshComponent* InstancedMesh = Cast<UInstancedStaticMeshComponent>(MeshComponent);
+	if (InstancedMesh != NULL && !InstancedMesh->GetInstanceTransform(Hit.Item, MeshToWorld, true))
+	{
+		return false;
+	}
+
+	const FVector LocalNormal = SmoothNormals->GetLocalSmoothNormal(Hit.FaceIndex, MeshToWorld.InverseTransformPosition(Hit.ImpactPoint));
+	if (LocalNormal.IsZero())
+	{
+		return false;
+	}
+
+	// Normals are transformed by the inverse of the scale.
+	OutNormal = MeshToWorld.GetRotation().RotateVector(LocalNormal * MeshToWorld.GetScale3D().Reciprocal()).GetSafeNormal();
+	if ((OutNormal | Hit.ImpactNormal) < 0.f)
+	{
+		OutNormal = -OutNormal;
+	}
+
+	return !OutNormal.IsZero();
+}
+
+FVector UDGSmoothNormalsUserData::GetLocalSmoothNormal(int32 FaceIndex, const FVector& LocalPoint) const
+{
+	if (FaceIndex < 0 || FaceIndex >= GetNumFaces())
+	{
+		return FVector::ZeroVector;
+	}
+
+	const int32 Corner = FaceIndex * 3;
+	const FVector& A = Vertices[Indices[Corner]];
+	const FVector& B = Vertices[Indices[Corner + 1]];
+	const FVector& C = Vertices[Indices[Corner + 2]];
+	if (((B - A) ^ (C - A)).SizeSquared() <= SMALL_NUMBER)
+	{
+		return CornerNormals[Corner];
+	}
+
+	// The impact point of a sweep may be slightly off the face.
+	FVector Weights = FMath::ComputeBaryCentric2D(LocalPoint, A, B, C).ComponentMax(FVector::ZeroVector);
+	const float WeightSum = Weights.X + Weights.Y + Weights.Z;
+	Weights = WeightSum > SMALL_NUMBER ? Weights / WeightSum : FVector(1.f / 3.f);
+
+	return (CornerNormals[Corner] * Weights.X + CornerNormals[Corner + 1] * Weights.Y + CornerNormals[Corner + 2] * Weights.Z).GetSafeNormal();
+}
+
+#if WITH_EDITOR
+void UDGSmoothNormalsUserData::Build(UStaticMesh* Mesh)
+{
+	Vertices.Reset();
+	Indices.Reset();
+	CornerNormals.Reset();
+
+	// The same triangles that the body setup cooks, so the face indices of the hits match.
+	FTriMeshCollisionData CollisionData;
+	if (Mesh == NULL || !Mesh->GetPhysicsTriMeshData(&CollisionData, false))
+	{
+		return;
+	}
+
+	// Weld the vertices split by the seams of the render mesh.
+	TMap<FVector, int32> WeldedVertices;
+	TArray<int32> VertexRemap;
+	VertexRemap.SetNumUninitialized(CollisionData.Vertices.Num());
+	for (int32 i = 0; i < CollisionData.Vertices.Num(); i++)
+	{
+		const FVector& Vertex = CollisionData.Vertices[i];
+		if (const int32* WeldedIndex = WeldedVertices.Find(Vertex))
+		{
+			VertexRemap[i] = *WeldedIndex;
+		}
+		else
+		{
+			VertexRemap[i] = Vertices.Add(Vertex);
+			WeldedVertices.Add(Vertex, VertexRemap[i]);
+		}
+	}
+
+	const int32 NumFaces = CollisionData.Indices.Num();
+	Indices.SetNumUninitialized(NumFaces * 3);
+
+	TArray<FVector> FaceNormals;
+	TArray<float> CornerAngles;
+	TArray<TArray<int32>> VertexFaces;
+	FaceNormals.SetNumUninitialized(NumFaces);
+	CornerAngles.SetNumUninitialized(NumFaces * 3);
+	VertexFaces.SetNum(Vertices.Num());
+
+	for (int32 Face = 0; Face < NumFaces; Face++)
+	{
+		const FTriIndices& Triangle = CollisionData.Indices[Face];
+		const int32 Corner = Face * 3;
+		Indices[Corner] = VertexRemap[Triangle.v0];
+		Indices[Corner + 1] = VertexRemap[Triangle.v1];
+		Indices[Corner + 2] = VertexRemap[Triangle.v2];
+
+		const FVector Points[3] = { Vertices[Indices[Corner]], Vertices[Indices[Corner + 1]], Vertices[Indices[Corner + 2]] };
+		FaceNormals[Face] = ((Points[2] - Points[0]) ^ (Points[1] - Points[0])).GetSafeNormal();
+
+		for (int32 k = 0; k < 3; k++)
+		{
+			const FVector ToNext = (Points[(k + 1) % 3] - Points[k]).GetSafeNormal();
+			const FVector ToPrevious = (Points[(k + 2) % 3] - Points[k]).GetSafeNormal();
+			CornerAngles[Corner + k] = FMath::Acos(FMath::Clamp(ToNext | ToPrevious, -1.f, 1.f));
+			VertexFaces[Indices[Corner + k]].AddUnique(Face);
+		}
+	}
+
+	// Angle weighted normals of the faces around each corner, without the faces across a crease.
+	const float CosCreaseAngle = FMath::Cos(FMath::DegreesToRadians(CreaseAngle));
+	CornerNormals.SetNumUninitialized(NumFaces * 3);
+	for (int32 Corner = 0; Corner < NumFaces * 3; Corner++)
+	{
+		const int32 Vertex = Indices[Corner];
+		const FVector& FaceNormal = FaceNormals[Corner / 3];
+
+		FVector Normal = FVector::ZeroVector;
+		for (const int32 AdjacentFace : VertexFaces[Vertex])
+		{
+			if ((FaceNormals[AdjacentFace] | FaceNormal) < CosCreaseAngle)
+			{
+				continue;
+			}
+
+			for (int32 k = 0; k < 3; k++)
+			{
+				if (Indices[AdjacentFace * 3 + k] == Vertex)
+				{
+					Normal += FaceNormals[AdjacentFace] * CornerAngles[AdjacentFace * 3 + k];
+					break;
+				}
+			}
+		}
+
+		CornerNormals[Corner] = Normal.IsNearlyZero() ? FaceNormal : Normal.GetSafeNormal();
+	}
+}
+
+void UDGSmoothNormalsUserData::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	Super::PreSave(TargetPlatform);
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		Build(Cast<UStaticMesh>(GetOuter()));
+	}
+}
+
+void UDGSmoothNormalsUserData::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Build(Cast<UStaticMesh>(GetOuter()));
+}
+#endif
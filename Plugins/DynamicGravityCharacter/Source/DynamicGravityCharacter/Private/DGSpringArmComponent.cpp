@@ -0,0 +1,206 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGSpringArmComponent.h"
+#include "DGCharacter.h"
+
+#include "CollisionQueryParams.h"
+#include "Engine/World.h"
+
+
+UDGSpringArmComponent::UDGSpringArmComponent()
+{
+	ProbeStationaryTolerance = 1.f;
+	ProbeMaxAge = 0.25f;
+
+	PreviousDesiredQuat = FQuat::Identity;
+	PreviousLagOffset = FVector::ZeroVector;
+	ProbeStart = FVector::ZeroVector;
+	ProbeEnd = FVector::ZeroVector;
+	ProbeTime = 0.f;
+	ProbeHitTime = 1.f;
+	ProbeFrame = 0;
+	bProbeBlockingHit = false;
+	bProbeValid = false;
+
+#if UE_SERVER
+	// Nobody looks through the camera of a server.
+	PrimaryComponentTick.bCanEverTick = false;
+#endif
+}
+
+void UDGSpringArmComponent::OnRegister()
+{
+	DGCharacter = Cast<ADGCharacter>(GetOwner());
+	bProbeValid = false;
+
+	Super::OnRegister();
+}
+
+FQuat UDGSpringArmComponent::GetFrameQuat() const
+{
+	const ADGCharacter* Character = DGCharacter.Get();
+	return Character != NULL ? Character->GetViewRotationBaseQuat() : FQuat::Identity;
+}
+
+FQuat UDGSpringArmComponent::GetTargetQuat() const
+{
+	FQuat DesiredQuat = GetComponentQuat();
+
+	if (bUsePawnControlRotation)
+	{
+		if (const ADGCharacter* Character = DGCharacter.Get())
+		{
+			DesiredQuat = Character->GetViewQuat();
+		}
+		else if (const APawn* OwningPawn = Cast<APawn>(GetOwner()))
+		{
+			DesiredQuat = OwningPawn->GetViewRotation().Quaternion();
+		}
+	}
+
+	// The inherit flags are relative to the frame of the arm, not to the world.
+	if (!IsUsingAbsoluteRotation() && (!bInheritPitch || !bInheritYaw || !bInheritRoll))
+	{
+		const FQuat FrameQuat = GetFrameQuat();
+		FRotator LocalRotation = (FrameQuat.Inverse() * DesiredQuat).Rotator();
+		const FRotator LocalRelativeRotation = GetRelativeRotation();
+		if (!bInheritPitch)
+		{
+			LocalRotation.Pitch = LocalRelativeRotation.Pitch;
+		}
+		if (!bInheritYaw)
+		{
+			LocalRotation.Yaw = LocalRelativeRotation.Yaw;
+		}
+		if (!bInheritRoll)
+		{
+			LocalRotation.Roll = LocalRelativeRotation.Roll;
+		}
+		DesiredQuat = FrameQuat * LocalRotation.Quaternion();
+	}
+
+	return DesiredQuat;
+}
+
+FRotator UDGSpringArmComponent::GetTargetRotation() const
+{
+	return GetTargetQuat().Rotator();
+}
+
+float UDGSpringArmComponent::GetLagAlpha(float DeltaTime, float LagSpeed) const
+{
+	if (LagSpeed <= 0.f)
+	{
+		return 1.f;
+	}
+
+	if (bUseCameraLagSubstepping && DeltaTime > CameraLagMaxTimeStep && CameraLagMaxTimeStep > 0.f)
+	{
+		const int32 NumSteps = FMath::CeilToInt(DeltaTime / CameraLagMaxTimeStep);
+		const float StepAlpha = FMath::Clamp(DeltaTime / NumSteps * LagSpeed, 0.f, 1.f);
+		return 1.f - FMath::Pow(1.f - StepAlpha, NumSteps);
+	}
+
+	return FMath::Clamp(DeltaTime * LagSpeed, 0.f, 1.f);
+}
+
+void UDGSpringArmComponent::UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime)
+{
+	const FQuat FrameQuat = GetFrameQuat();
+	FQuat DesiredQuat = GetTargetQuat();
+
+	if (bDoRotationLag)
+	{
+		DesiredQuat = FQuat::Slerp(PreviousDesiredQuat, DesiredQuat, GetLagAlpha(DeltaTime, CameraRotationLagSpeed)).GetNormalized();
+	}
+
+	PreviousDesiredQuat = DesiredQuat;
+	PreviousDesiredRot = DesiredQuat.Rotator();
+
+	// Get the spring arm 'origin', the target we want to look at.
+	const FVector ArmOrigin = GetComponentLocation() + FrameQuat.RotateVector(TargetOffset);
+	FVector DesiredLoc = ArmOrigin;
+
+	if (bDoLocationLag)
+	{
+		// The lag offset turns with the frame, so only the motion of the origin in the frame lags.
+		FVector LagOffset = PreviousLagOffset + FrameQuat.UnrotateVector(PreviousArmOrigin - ArmOrigin);
+		LagOffset *= 1.f - GetLagAlpha(DeltaTime, CameraLagSpeed);
+
+		if (CameraLagMaxDistance > 0.f)
+		{
+			LagOffset = LagOffset.GetClampedToMaxSize(CameraLagMaxDistance);
+		}
+
+		PreviousLagOffset = LagOffset;
+		DesiredLoc = ArmOrigin + FrameQuat.RotateVector(LagOffset);
+	}
+	else
+	{
+		PreviousLagOffset = FVector::ZeroVector;
+	}
+
+	PreviousArmOrigin = ArmOrigin;
+	PreviousDesiredLoc = DesiredLoc;
+
+	// Now offset camera position back along our rotation
+	DesiredLoc -= DesiredQuat.GetForwardVector() * TargetArmLength;
+	// Add socket offset in local space
+	DesiredLoc += DesiredQuat.RotateVector(SocketOffset);
+
+	FVector ResultLoc;
+	if (bDoTrace && (TargetArmLength != 0.0f))
+	{
+		bIsCameraFixed = true;
+
+		const UWorld* World = GetWorld();
+		const float Now = World->GetTimeSeconds();
+		const bool bReuseProbe = bProbeValid
+			&& (ProbeFrame == GFrameCounter || Now - ProbeTime <= ProbeMaxAge)
+			&& ArmOrigin.Equals(ProbeStart, ProbeStationaryTolerance)
+			&& DesiredLoc.Equals(ProbeEnd, ProbeStationaryTolerance);
+
+		if (!bReuseProbe)
+		{
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SpringArm), false, GetOwner());
+
+			FHitResult Result;
+			World->SweepSingleByChannel(Result, ArmOrigin, DesiredLoc, FQuat::Identity, ProbeChannel, FCollisionShape::MakeSphere(ProbeSize), QueryParams);
+
+			ProbeStart = ArmOrigin;
+			ProbeEnd = DesiredLoc;
+			ProbeTime = Now;
+			ProbeFrame = GFrameCounter;
+			ProbeHitTime = Result.bBlockingHit ? Result.Time : 1.f;
+			bProbeBlockingHit = Result.bBlockingHit;
+			bProbeValid = true;
+		}
+
+		UnfixedCameraPosition = DesiredLoc;
+
+		ResultLoc = BlendLocations(DesiredLoc, FMath::Lerp(ArmOrigin, DesiredLoc, ProbeHitTime), bProbeBlockingHit, DeltaTime);
+
+		if (ResultLoc == DesiredLoc)
+		{
+			bIsCameraFixed = false;
+		}
+	}
+	else
+	{
+		ResultLoc = DesiredLoc;
+		bIsCameraFixed = false;
+		UnfixedCameraPosition = ResultLoc;
+	}
+
+	// Form a transform for new world transform for camera
+	FTransform WorldCamTM(DesiredQuat, ResultLoc);
+	// Convert to relative to component
+	FTransform RelCamTM = WorldCamTM.GetRelativeTransform(GetComponentTransform());
+
+	// Update socket location/rotation
+	RelativeSocketLocation = RelCamTM.GetLocation();
+	RelativeSocketRotation = RelCamTM.GetRotation();
+
+	UpdateChildTransforms();
+}
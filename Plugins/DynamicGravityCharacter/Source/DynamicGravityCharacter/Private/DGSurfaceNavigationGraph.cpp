@@ -0,0 +1,511 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGSurfaceNavigationGraph.h"
+#include "DynamicGravityCharacter.h"
+
+#include "Algo/Reverse.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+
+namespace DGSurfaceNavigation
+{
+	struct FOpenEntry
+	{
+		int32 Index;
+		float Cost;
+
+		FOpenEntry(int32 InIndex, float InCost)
+			: Index(InIndex)
+			, Cost(InCost)
+		{
+		}
+	};
+
+	struct FOpenEntryPredicate
+	{
+		bool operator()(const FOpenEntry& A, const FOpenEntry& B) const
+		{
+			return A.Cost < B.Cost;
+		}
+	};
+
+	struct FSearchRecord
+	{
+		float Cost;
+		int32 Parent;
+	};
+
+	/**
+	 * Generic A*. ForEachNeighbor(Index, Visit) must call Visit(NeighborIndex, EdgeCost) for every neighbor, and Heuristic(Index) must not overestimate.
+	 * The records are sparse, so a search only touches the expanded part of the graph.
+	 */
+	template<typename NeighborFuncType, typename HeuristicFuncType>
+	bool AStar(int32 Start, int32 Goal, NeighborFuncType ForEachNeighbor, HeuristicFuncType Heuristic, TArray<int32>& OutPath)
+	{
+		OutPath.Reset();
+
+		TMap<int32, FSearchRecord> Records;
+		TSet<int32> Closed;
+		TArray<FOpenEntry> Open;
+
+		Records.Add(Start, { 0.f, INDEX_NONE });
+		Open.HeapPush(FOpenEntry(Start, Heuristic(Start)), FOpenEntryPredicate());
+
+		while (Open.Num() > 0)
+		{
+			FOpenEntry Current(INDEX_NONE, 0.f);
+			Open.HeapPop(Current, FOpenEntryPredicate(), false);
+
+			if (Current.Index == Goal)
+			{
+				for (int32 Index = Goal; Index != INDEX_NONE; Index = Records.FindChecked(Index).Parent)
+				{
+					OutPath.Add(Index);
+				}
+				Algo::Reverse(OutPath);
+				return true;
+			}
+
+			bool bAlreadyClosed = false;
+			Closed.Add(Current.Index, &bAlreadyClosed);
+			if (bAlreadyClosed)
+			{
+				continue;
+			}
+
+			const float CurrentCost = Records.FindChecked(Current.Index).Cost;
+			ForEachNeighbor(Current.Index, [&](int32 Neighbor, float EdgeCost)
+			{
+				if (Closed.Contains(Neighbor))
+				{
+					return;
+				}
+
+				const float NewCost = CurrentCost + EdgeCost;
+				FSearchRecord* Record = Records.Find(Neighbor);
+				if (Record == NULL || NewCost < Record->Cost)
+				{
+					Records.Add(Neighbor, { NewCost, Current.Index });
+					Open.HeapPush(FOpenEntry(Neighbor, NewCost + Heuristic(Neighbor)), FOpenEntryPredicate());
+				}
+			});
+		}
+
+		return false;
+	}
+}
+
+
+UDGSurfaceNavigationGraph::UDGSurfaceNavigationGraph()
+{
+	Bounds = FBox(FVector(-5000.f), FVector(5000.f));
+	SampleSpacing = 100.f;
+	NodeHeight = 20.f;
+	MaxEdgeLength = 175.f;
+	MaxEdgeAngle = 50.f;
+	MaxLayers = 4;
+	TraceChannel = ECC_WorldStatic;
+	ClusterSize = 1000.f;
+
+	MaxNodeQueryDistance = 300.f;
+	PathCacheSize = 32;
+}
+
+void UDGSurfaceNavigationGraph::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildNodeGrid();
+}
+
+FIntVector UDGSurfaceNavigationGraph::GetNodeCell(const FVector& Location) const
+{
+	const float CellSize = FMath::Max(1.f, MaxEdgeLength);
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UDGSurfaceNavigationGraph::BuildNodeGrid()
+{
+	NodeGrid.Reset();
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		NodeGrid.Add(GetNodeCell(Nodes[Index].Location), Index);
+	}
+}
+
+void UDGSurfaceNavigationGraph::BuildGraph(UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World == NULL || !Bounds.IsValid)
+	{
+		UE_LOG(LogDynamicGravity, Warning, TEXT("%s: BuildGraph needs a world and valid bounds."), *GetName());
+		return;
+	}
+
+	Nodes.Reset();
+	Edges.Reset();
+	Clusters.Reset();
+	ClusterLinks.Reset();
+	NodeGrid.Reset();
+	PathCache.Reset();
+
+	const float Spacing = FMath::Max(1.f, SampleSpacing);
+	const float MinEdgeDot = FMath::Cos(FMath::DegreesToRadians(MaxEdgeAngle));
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(DGSurfaceGraphBuild), true);
+
+	// Nodes closer than half the spacing to a node with a similar normal are merged.
+	const float MergeDistSquared = FMath::Square(Spacing * 0.5f);
+	auto AddSample = [&](const FVector& ImpactPoint, const FVector& Normal)
+	{
+		const FVector Location = ImpactPoint + Normal * NodeHeight;
+		const FIntVector Cell = GetNodeCell(Location);
+		for (int32 X = -1; X <= 1; ++X)
+		{
+			for (int32 Y = -1; Y <= 1; ++Y)
+			{
+				for (int32 Z = -1; Z <= 1; ++Z)
+				{
+					for (auto It = NodeGrid.CreateConstKeyIterator(Cell + FIntVector(X, Y, Z)); It; ++It)
+					{
+						const FDGSurfaceNavNode& Other = Nodes[It.Value()];
+						if (FVector::DistSquared(Other.Location, Location) < MergeDistSquared && (Other.Up | Normal) >= MinEdgeDot)
+						{
+							return;
+						}
+					}
+				}
+			}
+		}
+
+		FDGSurfaceNavNode& Node = Nodes.AddDefaulted_GetRef();
+		Node.Location = Location;
+		Node.Up = Normal;
+		NodeGrid.Add(Cell, Nodes.Num() - 1);
+	};
+
+	// Sample along the six axis directions, so every surface orientation is hit by some trace.
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		const int32 AxisU = (Axis + 1) % 3;
+		const int32 AxisV = (Axis + 2) % 3;
+
+		for (float Sign = -1.f; Sign <= 1.f; Sign += 2.f)
+		{
+			FVector Direction = FVector::ZeroVector;
+			Direction[Axis] = Sign;
+
+			for (float U = Bounds.Min[AxisU]; U <= Bounds.Max[AxisU]; U += Spacing)
+			{
+				for (float V = Bounds.Min[AxisV]; V <= Bounds.Max[AxisV]; V += Spacing)
+				{
+					FVector TraceStart, TraceEnd;
+					TraceStart[AxisU] = TraceEnd[AxisU] = U;
+					TraceStart[AxisV] = TraceEnd[AxisV] = V;
+					TraceStart[Axis] = Sign > 0.f ? Bounds.Min[Axis] : Bounds.Max[Axis];
+					TraceEnd[Axis] = Sign > 0.f ? Bounds.Max[Axis] : Bounds.Min[Axis];
+
+					for (int32 Layer = 0; Layer < MaxLayers; ++Layer)
+					{
+						FHitResult Hit;
+						if (!World->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, TraceChannel, QueryParams))
+						{
+							break;
+						}
+
+						if (!Hit.bStartPenetrating)
+						{
+							AddSample(Hit.ImpactPoint, Hit.ImpactNormal);
+						}
+
+						// Continue behind the surface to find the next layer.
+						TraceStart = Hit.ImpactPoint + Direction * FMath::Max(1.f, Spacing * 0.1f);
+						if (((TraceEnd - TraceStart) | Direction) <= 0.f)
+						{
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Connect the close nodes with similar normals and a clear line between them.
+	TArray<TArray<FDGSurfaceNavEdge>> NodeEdges;
+	NodeEdges.SetNum(Nodes.Num());
+	const float MaxEdgeLengthSquared = FMath::Square(MaxEdgeLength);
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		const FDGSurfaceNavNode& Node = Nodes[Index];
+		const FIntVector Cell = GetNodeCell(Node.Location);
+		for (int32 X = -1; X <= 1; ++X)
+		{
+			for (int32 Y = -1; Y <= 1; ++Y)
+			{
+				for (int32 Z = -1; Z <= 1; ++Z)
+				{
+					for (auto It = NodeGrid.CreateConstKeyIterator(Cell + FIntVector(X, Y, Z)); It; ++It)
+					{
+						const int32 OtherIndex = It.Value();
+						if (OtherIndex <= Index)
+						{
+							continue;
+						}
+
+						const FDGSurfaceNavNode& Other = Nodes[OtherIndex];
+						const float DistSquared = FVector::DistSquared(Node.Location, Other.Location);
+						if (DistSquared > MaxEdgeLengthSquared || (Node.Up | Other.Up) < MinEdgeDot)
+						{
+							continue;
+						}
+
+						if (World->LineTraceTestByChannel(Node.Location, Other.Location, TraceChannel, QueryParams))
+						{
+							continue;
+						}
+
+						const float Cost = FMath::Sqrt(DistSquared);
+						NodeEdges[Index].Add(FDGSurfaceNavEdge(OtherIndex, Cost));
+						NodeEdges[OtherIndex].Add(FDGSurfaceNavEdge(Index, Cost));
+					}
+				}
+			}
+		}
+	}
+
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		Nodes[Index].FirstEdge = Edges.Num();
+		Nodes[Index].NumEdges = NodeEdges[Index].Num();
+		Edges.Append(NodeEdges[Index]);
+	}
+
+	// Clusters are the connected nodes inside the same cell.
+	const float ClusterCellSize = FMath::Max(1.f, ClusterSize);
+	auto GetClusterCell = [ClusterCellSize](const FVector& Location)
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / ClusterCellSize), FMath::FloorToInt(Location.Y / ClusterCellSize), FMath::FloorToInt(Location.Z / ClusterCellSize));
+	};
+
+	TArray<int32> Stack;
+	for (int32 Index = 0; Index < Nodes.Num(); ++Index)
+	{
+		if (Nodes[Index].Cluster != INDEX_NONE)
+		{
+			continue;
+		}
+
+		const int32 ClusterIndex = Clusters.AddDefaulted();
+		const FIntVector ClusterCell = GetClusterCell(Nodes[Index].Location);
+		FVector LocationSum = FVector::ZeroVector;
+		int32 NumClusterNodes = 0;
+
+		Nodes[Index].Cluster = ClusterIndex;
+		Stack.Add(Index);
+		while (Stack.Num() > 0)
+		{
+			const FDGSurfaceNavNode& Node = Nodes[Stack.Pop(false)];
+			LocationSum += Node.Location;
+			++NumClusterNodes;
+
+			for (int32 EdgeIndex = Node.FirstEdge; EdgeIndex < Node.FirstEdge + Node.NumEdges; ++EdgeIndex)
+			{
+				FDGSurfaceNavNode& Target = Nodes[Edges[EdgeIndex].Target];
+				if (Target.Cluster == INDEX_NONE && GetClusterCell(Target.Location) == ClusterCell)
+				{
+					Target.Cluster = ClusterIndex;
+					Stack.Add(Edges[EdgeIndex].Target);
+				}
+			}
+		}
+
+		Clusters[ClusterIndex].Center = LocationSum / NumClusterNodes;
+	}
+
+	TArray<TSet<int32>> Links;
+	Links.SetNum(Clusters.Num());
+	for (const FDGSurfaceNavNode& Node : Nodes)
+	{
+		for (int32 EdgeIndex = Node.FirstEdge; EdgeIndex < Node.FirstEdge + Node.NumEdges; ++EdgeIndex)
+		{
+			const int32 TargetCluster = Nodes[Edges[EdgeIndex].Target].Cluster;
+			if (TargetCluster != Node.Cluster)
+			{
+				Links[Node.Cluster].Add(TargetCluster);
+			}
+		}
+	}
+
+	for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ++ClusterIndex)
+	{
+		Clusters[ClusterIndex].FirstLink = ClusterLinks.Num();
+		Clusters[ClusterIndex].NumLinks = Links[ClusterIndex].Num();
+		ClusterLinks.Append(Links[ClusterIndex].Array());
+	}
+
+	UE_LOG(LogDynamicGravity, Log, TEXT("%s: built %d nodes, %d edges and %d clusters."), *GetName(), Nodes.Num(), Edges.Num(), Clusters.Num());
+
+	MarkPackageDirty();
+}
+
+int32 UDGSurfaceNavigationGraph::FindNearestNode(const FVector& Location, const FVector& Up) const
+{
+	const float CellSize = FMath::Max(1.f, MaxEdgeLength);
+	const int32 CellRange = FMath::Max(1, FMath::CeilToInt(MaxNodeQueryDistance / CellSize));
+	const FIntVector Cell = GetNodeCell(Location);
+
+	int32 BestNode = INDEX_NONE;
+	float BestDistSquared = FMath::Square(MaxNodeQueryDistance);
+	for (int32 X = -CellRange; X <= CellRange; ++X)
+	{
+		for (int32 Y = -CellRange; Y <= CellRange; ++Y)
+		{
+			for (int32 Z = -CellRange; Z <= CellRange; ++Z)
+			{
+				for (auto It = NodeGrid.CreateConstKeyIterator(Cell + FIntVector(X, Y, Z)); It; ++It)
+				{
+					const FDGSurfaceNavNode& Node = Nodes[It.Value()];
+					const float DistSquared = FVector::DistSquared(Node.Location, Location);
+					if (DistSquared < BestDistSquared && (Node.Up | Up) >= 0.f)
+					{
+						BestDistSquared = DistSquared;
+						BestNode = It.Value();
+					}
+				}
+			}
+		}
+	}
+
+	return BestNode;
+}
+
+bool UDGSurfaceNavigationGraph::FindClusterCorridor(int32 StartCluster, int32 EndCluster, TSet<int32>& OutCorridor) const
+{
+	OutCorridor.Reset();
+
+	const FVector GoalCenter = Clusters[EndCluster].Center;
+	TArray<int32> ClusterPath;
+	const bool bFound = DGSurfaceNavigation::AStar(StartCluster, EndCluster,
+		[this](int32 Index, TFunctionRef<void(int32, float)> Visit)
+		{
+			const FDGSurfaceNavCluster& Cluster = Clusters[Index];
+			for (int32 LinkIndex = Cluster.FirstLink; LinkIndex < Cluster.FirstLink + Cluster.NumLinks; ++LinkIndex)
+			{
+				const int32 Neighbor = ClusterLinks[LinkIndex];
+				Visit(Neighbor, FVector::Dist(Cluster.Center, Clusters[Neighbor].Center));
+			}
+		},
+		[this, &GoalCenter](int32 Index)
+		{
+			return FVector::Dist(Clusters[Index].Center, GoalCenter);
+		},
+		ClusterPath);
+
+	if (!bFound)
+	{
+		return false;
+	}
+
+	// The neighbors of the path clusters too, so the node search isn't stuck by the cluster borders.
+	for (const int32 ClusterIndex : ClusterPath)
+	{
+		OutCorridor.Add(ClusterIndex);
+
+		const FDGSurfaceNavCluster& Cluster = Clusters[ClusterIndex];
+		for (int32 LinkIndex = Cluster.FirstLink; LinkIndex < Cluster.FirstLink + Cluster.NumLinks; ++LinkIndex)
+		{
+			OutCorridor.Add(ClusterLinks[LinkIndex]);
+		}
+	}
+
+	return true;
+}
+
+bool UDGSurfaceNavigationGraph::FindNodePath(int32 StartNode, int32 EndNode, const TSet<int32>* Corridor, TArray<int32>& OutNodes) const
+{
+	const FVector GoalLocation = Nodes[EndNode].Location;
+	return DGSurfaceNavigation::AStar(StartNode, EndNode,
+		[this, Corridor](int32 Index, TFunctionRef<void(int32, float)> Visit)
+		{
+			const FDGSurfaceNavNode& Node = Nodes[Index];
+			for (int32 EdgeIndex = Node.FirstEdge; EdgeIndex < Node.FirstEdge + Node.NumEdges; ++EdgeIndex)
+			{
+				const FDGSurfaceNavEdge& Edge = Edges[EdgeIndex];
+				if (Corridor == NULL || Corridor->Contains(Nodes[Edge.Target].Cluster))
+				{
+					Visit(Edge.Target, Edge.Cost);
+				}
+			}
+		},
+		[this, &GoalLocation](int32 Index)
+		{
+			return FVector::Dist(Nodes[Index].Location, GoalLocation);
+		},
+		OutNodes);
+}
+
+bool UDGSurfaceNavigationGraph::FindPath(const FVector& Start, const FVector& End, FDGSurfacePath& OutPath, const FVector& StartUp, const FVector& EndUp)
+{
+	OutPath.Reset();
+
+	if (Nodes.Num() > 0 && NodeGrid.Num() == 0)
+	{
+		BuildNodeGrid();
+	}
+
+	const int32 StartNode = FindNearestNode(Start, StartUp);
+	const int32 EndNode = FindNearestNode(End, EndUp);
+	if (StartNode == INDEX_NONE || EndNode == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TArray<int32> NodePath;
+	const int32 CachedIndex = PathCache.IndexOfByPredicate([StartNode, EndNode](const FCachedPath& Cached) { return Cached.StartNode == StartNode && Cached.EndNode == EndNode; });
+	if (CachedIndex != INDEX_NONE)
+	{
+		// Move to the back, as the most recently used.
+		FCachedPath Cached = MoveTemp(PathCache[CachedIndex]);
+		PathCache.RemoveAt(CachedIndex, 1, false);
+		NodePath = Cached.Nodes;
+		PathCache.Add(MoveTemp(Cached));
+	}
+	else
+	{
+		TSet<int32> Corridor;
+		if (!FindClusterCorridor(Nodes[StartNode].Cluster, Nodes[EndNode].Cluster, Corridor))
+		{
+			return false;
+		}
+
+		// The corridor can miss a path that leaves it, so fall back to the full search.
+		if (!FindNodePath(StartNode, EndNode, &Corridor, NodePath) && !FindNodePath(StartNode, EndNode, NULL, NodePath))
+		{
+			return false;
+		}
+
+		if (PathCacheSize > 0)
+		{
+			if (PathCache.Num() >= PathCacheSize)
+			{
+				PathCache.RemoveAt(0, PathCache.Num() - PathCacheSize + 1, false);
+			}
+			PathCache.Add({ StartNode, EndNode, NodePath });
+		}
+	}
+
+	OutPath.Points.Reserve(NodePath.Num() + 1);
+	OutPath.Ups.Reserve(NodePath.Num() + 1);
+	for (const int32 NodeIndex : NodePath)
+	{
+		OutPath.Points.Add(Nodes[NodeIndex].Location);
+		OutPath.Ups.Add(Nodes[NodeIndex].Up);
+	}
+
+	// End exactly at the goal.
+	OutPath.Points.Add(End);
+	OutPath.Ups.Add(Nodes[EndNode].Up);
+
+	return true;
+}
@@ -2,6 +2,8 @@
 
 #include "DynamicGravityCharacter.h"
 
+DEFINE_LOG_CATEGORY(LogDynamicGravity);
+
 #define LOCTEXT_NAMESPACE "FDynamicGravityCharacterModule"
 
 void FDynamicGravityCharacterModule::StartupModule()
@@ -0,0 +1,134 @@
+// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+
+#include "DGCharacter.h"
+#include "DGCharacterMovementComponent.h"
+
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Forwards to the allocator it wraps, and counts the allocations made on the game thread. */
+class FDGCountingMalloc final : public FMalloc
+{
+	FMalloc* Inner;
+
+public:
+	int32 GameThreadAllocations;
+
+	explicit FDGCountingMalloc(FMalloc* InInner)
+		: Inner(InInner)
+		, GameThreadAllocations(0)
+	{
+	}
+
+	FMalloc* GetInner() const { return Inner; }
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Count > 0)
+		{
+			CountAllocation();
+		}
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("DGCountingMalloc"); }
+
+private:
+	FORCEINLINE void CountAllocation()
+	{
+		if (IsInGameThread())
+		{
+			++GameThreadAllocations;
+		}
+	}
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDGWalkingTickAllocationTest, "DynamicGravityCharacter.Movement.WalkingTickAllocations", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDGWalkingTickAllocationTest::RunTest(const FString& Parameters)
+{
+	UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(NULL, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!TestNotNull(TEXT("Floor mesh"), CubeMesh))
+	{
+		return false;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// A 100 m wide floor, with its top at Z = 50.
+	AStaticMeshActor* Floor = World->SpawnActor<AStaticMeshActor>(FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters);
+	Floor->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+	Floor->GetStaticMeshComponent()->SetStaticMesh(CubeMesh);
+	Floor->SetActorScale3D(FVector(100.f, 100.f, 1.f));
+
+	ADGCharacter* Character = World->SpawnActor<ADGCharacter>(FVector(0.f, 0.f, 140.f), FRotator::ZeroRotator, SpawnParameters);
+	UDGCharacterMovementComponent* MovementComponent = Character->GetDGCharacterMovement();
+	if (TestNotNull(TEXT("Movement component"), MovementComponent))
+	{
+		MovementComponent->bRunPhysicsWithNoController = true;
+		MovementComponent->SetMovementMode(MOVE_Walking);
+
+		const float DeltaTime = 1.f / 60.f;
+		const auto TickWalking = [&]()
+		{
+			Character->AddMovementInput(FVector::ForwardVector, 1.f);
+			MovementComponent->TickComponent(DeltaTime, LEVELTICK_All, &MovementComponent->PrimaryComponentTick);
+		};
+
+		// Let the caches and arrays grow to their steady size.
+		for (int32 Tick = 0; Tick < 30; ++Tick)
+		{
+			TickWalking();
+		}
+		TestTrue(TEXT("Walking before measuring"), MovementComponent->IsMovingOnGround());
+
+		FDGCountingMalloc CountingMalloc(GMalloc);
+		GMalloc = &CountingMalloc;
+		for (int32 Tick = 0; Tick < 10; ++Tick)
+		{
+			TickWalking();
+		}
+		GMalloc = CountingMalloc.GetInner();
+
+		TestTrue(TEXT("Walking after measuring"), MovementComponent->IsMovingOnGround());
+		TestEqual(TEXT("Heap allocations of steady state walking ticks"), CountingMalloc.GameThreadAllocations, 0);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,235 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "DGAgentCrowd.generated.h"
+
+class ADGCharacter;
+class UDGMovementSettings;
+class UInstancedStaticMeshComponent;
+
+
+/** A background NPC of an ADGAgentCrowd. */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGCrowdAgent
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Location of the capsule center. */
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		FVector Location;
+
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		FVector Velocity;
+
+	/** The vertical direction of the agent. @see UDGCharacterMovementComponent::VerticalDirection */
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		FVector Up;
+
+	/** The forward direction of the agent, perpendicular to Up. */
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		FVector Forward;
+
+	/** Requested move direction, scaled from 0 to 1. Forwarded to the character while the agent is promoted. */
+	UPROPERTY(Category = "Agent", BlueprintReadWrite)
+		FVector MoveInput;
+
+	/** Dynamic gravity of the agent. @see UDGCharacterMovementComponent::DynamicGravity */
+	UPROPERTY(Category = "Agent", BlueprintReadWrite)
+		FVector DynamicGravity;
+
+	/** Gravity of the fields sampled at the agent this frame, added to DynamicGravity. @see UDGCharacterMovementComponent::FieldGravity */
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		FVector FieldGravity;
+
+	/** Plane of the last floor probe. */
+	FVector FloorPoint;
+	FVector FloorNormal;
+
+	/** The full character this agent was promoted to. */
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		TWeakObjectPtr<ADGCharacter> PromotedCharacter;
+
+	UPROPERTY(Category = "Agent", BlueprintReadOnly)
+		uint8 bOnGround : 1;
+
+	/** If true, the floor is probed in the next frame regardless of the probe budget. */
+	uint8 bNeedsProbe : 1;
+
+	FDGCrowdAgent()
+		: Location(ForceInitToZero)
+		, Velocity(ForceInitToZero)
+		, Up(FVector::UpVector)
+		, Forward(FVector::ForwardVector)
+		, MoveInput(ForceInitToZero)
+		, DynamicGravity(ForceInitToZero)
+		, FieldGravity(ForceInitToZero)
+		, FloorPoint(ForceInitToZero)
+		, FloorNormal(FVector::UpVector)
+		, bOnGround(false)
+		, bNeedsProbe(true)
+	{
+	}
+
+	bool IsPromoted() const { return PromotedCharacter.IsValid(); }
+
+	/** DynamicGravity plus FieldGravity. @see UDGCharacterMovementComponent::GetDynamicGravity */
+	FVector GetDynamicGravity() const { return DynamicGravity + FieldGravity; }
+};
+
+
+/**
+ * Thousands of background NPCs without actors, drawn by instanced static meshes.
+ * The agents follow the gravity rules of UDGCharacterMovementComponent (Gravity(), walkable floor normal and jump direction) from MovementSettings,
+ * with analytic motion updated in batches, the gravity fields sampled in one pass if bSampleGravityFields is true and a budget of floor line probes per frame.
+ * Only the instances of agents that moved are sent to the renderer.
+ * Agents near the local player are promoted to full PromotedCharacterClass characters, and demoted back when they get far.
+ */
+UCLASS()
+class DYNAMICGRAVITYCHARACTER_API ADGAgentCrowd : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ADGAgentCrowd();
+
+	/** Draws the agents. */
+	UPROPERTY(Category = "Crowd", VisibleAnywhere, BlueprintReadOnly)
+		UInstancedStaticMeshComponent* Instances;
+
+	/** Gravity rules of the agents. Uses the defaults of UDGCharacterMovementComponent if null. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite)
+		UDGMovementSettings* MovementSettings;
+
+	/** If true, the gravity fields of the world are sampled for the agents every frame, and for the characters they are promoted to. @see UDGCharacterMovementComponent::bSampleGravityFields */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite)
+		bool bSampleGravityFields;
+
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float MaxWalkSpeed;
+
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float MaxAcceleration;
+
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float JumpZVelocity;
+
+	/** Half height of the capsule of the agents. Their location is the capsule center. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float CapsuleHalfHeight;
+
+	/** Maximum angle, in degrees, between the floor normal and the walkable floor normal. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "90", UIMin = "0", UIMax = "90"))
+		float WalkableFloorAngle;
+
+	/** How far below the feet a floor probe looks. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float ProbeDistance;
+
+	/** Number of walking agents whose floor is probed each frame. Falling agents are probed every frame. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		int32 ProbesPerFrame;
+
+	/** Walking agents farther than this from their last probe are probed in the next frame. */
+	UPROPERTY(Category = "Crowd", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float ProbeValidDistance;
+
+	/** Class of the characters that relevant agents are promoted to. No promotion if null. Promoted characters get their default controller if they aren't possessed on spawn. */
+	UPROPERTY(Category = "Crowd|Promotion", EditAnywhere, BlueprintReadWrite)
+		TSubclassOf<ADGCharacter> PromotedCharacterClass;
+
+	/** Agents closer than this to the local player are promoted. */
+	UPROPERTY(Category = "Crowd|Promotion", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float PromotionDistance;
+
+	/** Promoted agents farther than this from the local player are demoted. Should be greater than PromotionDistance. */
+	UPROPERTY(Category = "Crowd|Promotion", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float DemotionDistance;
+
+	/** Maximum number of agents promoted in a frame, so a dense crowd entering PromotionDistance spawns its characters over several frames. */
+	UPROPERTY(Category = "Crowd|Promotion", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1"))
+		int32 MaxPromotionsPerFrame;
+
+
+	/**
+	 * Adds an agent.
+	 * @param Location	Location of the capsule center.
+	 * @param Forward	Initial forward direction.
+	 * @return The index of the agent.
+	 */
+	UFUNCTION(Category = "Crowd", BlueprintCallable)
+		int32 AddAgent(FVector Location, FVector Forward);
+
+	/** Sets the move input of an agent, scaled from 0 to 1. @see FDGCrowdAgent::MoveInput */
+	UFUNCTION(Category = "Crowd", BlueprintCallable)
+		void SetAgentMoveInput(int32 AgentIndex, FVector MoveInput);
+
+	/** Jumps with an agent on ground, along its jump direction. @see UDGCharacterMovementComponent::JumpDirection */
+	UFUNCTION(Category = "Crowd", BlueprintCallable)
+		bool JumpAgent(int32 AgentIndex);
+
+	/** Replaces an agent by a full character. @return The character, or null if the agent can't be promoted. */
+	UFUNCTION(Category = "Crowd", BlueprintCallable)
+		ADGCharacter* PromoteAgent(int32 AgentIndex);
+
+	/** Destroys the character of a promoted agent and moves the agent back to the crowd. */
+	UFUNCTION(Category = "Crowd", BlueprintCallable)
+		void DemoteAgent(int32 AgentIndex);
+
+	UFUNCTION(Category = "Crowd", BlueprintPure)
+		int32 GetNumAgents() const { return Agents.Num(); }
+
+	const FDGCrowdAgent& GetAgent(int32 AgentIndex) const { return Agents[AgentIndex]; }
+
+	virtual void Tick(float DeltaSeconds) override;
+
+
+protected:
+
+	/** Samples the field gravity of all the agents in one pass. */
+	void SampleAgentGravity();
+
+	/** Analytic walking and falling of all the crowd agents. */
+	void MoveAgents(float DeltaSeconds);
+
+	/** Line probes the floor of the agents that need it, and the next ProbesPerFrame walking agents. Only world static and world dynamic objects are floors, so agents don't land on pawns. */
+	void ProbeFloors();
+
+	/** Promotes and demotes the agents by their distance to the local player. At most MaxPromotionsPerFrame agents are promoted. */
+	void UpdatePromotion();
+
+	/** Writes the instance transforms of the crowd agents that moved, in contiguous ranges. */
+	void UpdateInstances();
+
+	/** Gravity of an agent. @see UDGCharacterMovementComponent::Gravity */
+	FVector GetAgentGravity(const FDGCrowdAgent& Agent) const;
+
+	/** Walkable floor normal of an agent. @see UDGCharacterMovementComponent::WalkableFloorNormal */
+	FVector GetAgentWalkableFloorNormal(const FDGCrowdAgent& Agent) const;
+
+	/** Jump direction of an agent. @see UDGCharacterMovementComponent::JumpDirection */
+	FVector GetAgentJumpDirection(const FDGCrowdAgent& Agent) const;
+
+	/**
+	 * The up direction that the rotation of an agent turns to. @see UDGCharacterMovementComponent::PhysicsRotationVerticalDirectionMode
+	 * Agents have no rotation apart from their vertical direction, so in Vertical Direction mode they turn to their floor.
+	 */
+	FVector GetAgentRotationVerticalDirection(const FDGCrowdAgent& Agent) const;
+
+	UPROPERTY(Category = "Crowd", VisibleInstanceOnly, BlueprintReadOnly)
+		TArray<FDGCrowdAgent> Agents;
+
+	/** Index of the next walking agent to probe. */
+	int32 ProbeCursor;
+
+	/** Scratch buffers of the batched passes. */
+	TArray<FVector> AgentLocations;
+	TArray<FVector> AgentGravity;
+	TArray<FTransform> MovedInstanceTransforms;
+
+	/** The transforms last written to Instances, one per agent. */
+	TArray<FTransform> InstanceTransforms;
+};
@@ -0,0 +1,183 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "DGAnimInstance.generated.h"
+
+class ADGCharacter;
+class UDGAnimInstance;
+class UDGCharacterMovementComponent;
+
+
+/** Locomotion of a dynamic gravity character in the frame of its vertical direction, gathered once per animation update. */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGLocomotionSnapshot
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector Velocity;
+
+	/** Velocity perpendicular to VerticalDirection. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector HorizontalVelocity;
+
+	/** Velocity along VerticalDirection. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector VerticalVelocity;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		float Speed;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		float HorizontalSpeed;
+
+	/** Velocity along VerticalDirection, as a signed value: negative while moving down. Unlike Speed and HorizontalSpeed, it is not a magnitude. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		float SignedVerticalSpeed;
+
+	/** Angle, in degrees, from the forward of the character to the horizontal velocity, around VerticalDirection. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		float Direction;
+
+	/** Input acceleration perpendicular to VerticalDirection. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector HorizontalAcceleration;
+
+	/** @see UDGCharacterMovementComponent::VerticalDirection */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector VerticalDirection;
+
+	/** Normal of the floor surface, or VerticalDirection without a walkable floor. @see UDGCharacterMovementComponent::GetSmoothFloorImpactNormal */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector SurfaceNormal;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		TEnumAsByte<EMovementMode> MovementMode;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsFalling : 1;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsMovingOnGround : 1;
+
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsCrouching : 1;
+
+	/** True if there is input acceleration. */
+	UPROPERTY(Category = "Locomotion", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsAccelerating : 1;
+
+	FDGLocomotionSnapshot()
+		: Velocity(ForceInitToZero)
+		, HorizontalVelocity(ForceInitToZero)
+		, VerticalVelocity(ForceInitToZero)
+		, Speed(0.f)
+		, HorizontalSpeed(0.f)
+		, SignedVerticalSpeed(0.f)
+		, Direction(0.f)
+		, HorizontalAcceleration(ForceInitToZero)
+		, VerticalDirection(FVector::UpVector)
+		, SurfaceNormal(FVector::UpVector)
+		, MovementMode(MOVE_None)
+		, bIsFalling(false)
+		, bIsMovingOnGround(false)
+		, bIsCrouching(false)
+		, bIsAccelerating(false)
+	{
+	}
+};
+
+
+/**
+ * Proxy of UDGAnimInstance. PreUpdate copies the raw state of the character on the game thread,
+ * and Update builds the locomotion snapshot on the animation worker thread, before the anim graph is updated.
+ */
+struct DYNAMICGRAVITYCHARACTER_API FDGAnimInstanceProxy : public FAnimInstanceProxy
+{
+	FDGAnimInstanceProxy()
+		: DGAnimInstance(NULL)
+		, Velocity(ForceInitToZero)
+		, Acceleration(ForceInitToZero)
+		, VerticalDirection(FVector::UpVector)
+		, SurfaceNormal(FVector::UpVector)
+		, ActorQuat(FQuat::Identity)
+		, MovementMode(MOVE_None)
+		, bIsMovingOnGround(false)
+		, bIsCrouching(false)
+	{
+	}
+
+	FDGAnimInstanceProxy(UAnimInstance* InAnimInstance);
+
+	virtual void Initialize(UAnimInstance* InAnimInstance) override;
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void Update(float DeltaSeconds) override;
+
+
+protected:
+
+	UDGAnimInstance* DGAnimInstance;
+
+	/** State of the character copied on the game thread. */
+	FVector Velocity;
+	FVector Acceleration;
+	FVector VerticalDirection;
+	FVector SurfaceNormal;
+	FQuat ActorQuat;
+	TEnumAsByte<EMovementMode> MovementMode;
+	bool bIsMovingOnGround;
+	bool bIsCrouching;
+};
+
+
+/**
+ * Animation instance of dynamic gravity characters, with the locomotion in the frame of the vertical direction.
+ * The snapshot is built once per frame off the game thread, so anim graphs can read it without calling the Blueprint functions of ADGCharacter.
+ * Server builds don't build the snapshot, and it keeps its defaults there.
+ * @see FDGLocomotionSnapshot
+ */
+UCLASS(Transient, Blueprintable)
+class DYNAMICGRAVITYCHARACTER_API UDGAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+	friend struct FDGAnimInstanceProxy;
+
+public:
+
+	UDGAnimInstance();
+
+	/** The locomotion of this frame. */
+	UPROPERTY(Category = "Dynamic Gravity", VisibleInstanceOnly, BlueprintReadOnly)
+		FDGLocomotionSnapshot Locomotion;
+
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure, meta = (BlueprintThreadSafe))
+		const FDGLocomotionSnapshot& GetLocomotion() const { return Locomotion; }
+
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		ADGCharacter* GetDGCharacter() const { return DGCharacter.Get(); }
+
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		UDGCharacterMovementComponent* GetDGMovement() const { return DGMovement.Get(); }
+
+	virtual void NativeInitializeAnimation() override;
+
+
+protected:
+
+	/**
+	 * Called on the animation worker thread after Locomotion is built, before the anim graph is updated.
+	 * Only the snapshot and the proxy may be read here, not the character.
+	 */
+	virtual void NativeThreadSafeUpdateLocomotion(float DeltaSeconds) {}
+
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
+	/** The owner and its movement, found once instead of cast every frame. */
+	TWeakObjectPtr<ADGCharacter> DGCharacter;
+	TWeakObjectPtr<UDGCharacterMovementComponent> DGMovement;
+};
@@ -0,0 +1,66 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "DGAvoidanceSubsystem.generated.h"
+
+class UDGCharacterMovementComponent;
+
+
+/**
+ * Local avoidance (ORCA) between dynamic gravity characters, solved in the tangent plane of each character, defined by its vertical direction.
+ * Unlike the built-in RVO avoidance, it works for characters on walls, ceilings and spheres.
+ * The agents are kept in a spatial hash rebuilt at most once per frame.
+ * @see UDGCharacterMovementComponent::bUseTangentAvoidance
+ */
+UCLASS()
+class DYNAMICGRAVITYCHARACTER_API UDGAvoidanceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGAvoidanceSubsystem();
+
+	/** Size of the cells of the spatial hash. */
+	float CellSize;
+
+	void RegisterAgent(UDGCharacterMovementComponent* Agent);
+	void UnregisterAgent(UDGCharacterMovementComponent* Agent);
+
+	/**
+	 * The velocity closest to PreferredVelocity that avoids the neighbors of Agent for its time horizon.
+	 * @param Agent				The avoiding character.
+	 * @param PreferredVelocity	The velocity the character wants.
+	 * @param DeltaTime			The time step of the move.
+	 * @return The avoidance velocity. Only its tangent component is changed.
+	 */
+	FVector ComputeAvoidanceVelocity(const UDGCharacterMovementComponent* Agent, const FVector& PreferredVelocity, float DeltaTime);
+
+	int32 GetNumAgents() const { return Agents.Num(); }
+
+
+private:
+
+	/** State of an agent at the start of the frame. */
+	struct FAgentState
+	{
+		FVector Location;
+		FVector Velocity;
+		FVector Up;
+		float Radius;
+		const UDGCharacterMovementComponent* Component;
+	};
+
+	/** Rebuilds AgentStates and SpatialHash if they are from an older frame. */
+	void UpdateSpatialHash();
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	TArray<TWeakObjectPtr<UDGCharacterMovementComponent>> Agents;
+	TArray<FAgentState> AgentStates;
+	TMultiMap<FIntVector, int32> SpatialHash;
+	uint64 SpatialHashFrame;
+};
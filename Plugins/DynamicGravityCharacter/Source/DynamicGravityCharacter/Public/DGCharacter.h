@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "DGKinematicsSnapshot.h"
 #include "DGCharacter.generated.h"
 
 class UDGCharacterMovementComponent;
@@ -44,16 +45,54 @@ struct FHorizontalAndVerticalVelocities
 	}
 };
 
+/** Input directions of a world rotation around a vertical direction. @see ADGCharacter::AddPlanarMovementInput, ADGCharacter::AddRadialMovementInput */
+struct FDGMovementInputBasis
+{
+	/** Forward of the rotation projected on the horizontal plane. */
+	FVector PlanarForward;
+
+	/** Right of the rotation. */
+	FVector PlanarRight;
+
+	/** Horizontal direction perpendicular to the right of the rotation. */
+	FVector RadialForward;
+
+	/** Horizontal direction perpendicular to the forward of the rotation. */
+	FVector RadialRight;
+
+	FDGMovementInputBasis()
+		: PlanarForward(ForceInitToZero)
+		, PlanarRight(ForceInitToZero)
+		, RadialForward(ForceInitToZero)
+		, RadialRight(ForceInitToZero)
+	{
+	}
+
+	FDGMovementInputBasis(const FQuat& WorldRotation, const FVector& VerticalDirection);
+};
+
 UCLASS()
 class DYNAMICGRAVITYCHARACTER_API ADGCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
-		const FRotator DEFAULT_CUSTOM_VIEW_ROTATION_BASE = FRotator(0, 0, 0);
+		static const FRotator DEFAULT_CUSTOM_VIEW_ROTATION_BASE;
 
 	FORCEINLINE void UpdateRawViewRotation(float DeltaTime, UDGCharacterMovementComponent* MovementComponent);
+
+	/**
+	 * Turns the view rotation base to the vertical direction of ViewRotationBaseMode.
+	 * @param Alpha		Fraction of the turn done in this call, 1 to turn at once.
+	 */
+	void UpdateViewRotationBase(const UDGCharacterMovementComponent* MovementComponent, float Alpha);
 	FORCEINLINE void UpdateControlRotation(float DeltaTime, UDGCharacterMovementComponent* MovementComponent);
 
+	/**
+	 * The vertical direction of the view rotation base, by ViewRotationBaseMode.
+	 * @return False if the view rotation base doesn't follow a direction (Control Rotation and Custom modes).
+	 */
+	bool GetViewRotationBaseVerticalDirection(const UDGCharacterMovementComponent* MovementComponent, FVector& OutVerticalDirection) const;
+
 	/**
 	 * The view rotation base mode. view rotation base is the view rotation without control rotation.
 	 *    - Gravity: The view rotation base is related to the negative direction of the gravity.
@@ -72,6 +111,18 @@ class DYNAMICGRAVITYCHARACTER_API ADGCharacter : public ACharacter
 	UPROPERTY(Category = "View Rotation", EditAnywhere)
 		FRotator CustomViewRotationBase;
 
+	/** ViewRotationBase as a quaternion, kept from the last update to avoid converting it back. */
+	FQuat ViewRotationBaseQuat;
+
+	/** The dynamic gravity movement component, found once. */
+	UDGCharacterMovementComponent* DGCharacterMovement;
+
+	/** Input basis of the view rotation, with the control rotation, view rotation base and vertical direction it was built from. @see GetViewMovementInputBasis */
+	FDGMovementInputBasis ViewInputBasis;
+	FRotator ViewInputBasisControlRotation;
+	FQuat ViewInputBasisBaseQuat;
+	FVector ViewInputBasisVerticalDirection;
+
 	bool ResetingPitchControlRotation;
 	bool ResetingYawControlRotation;
 	bool ResetingRollControlRotation;
@@ -140,6 +191,53 @@ public:
 		void AddRightRadialMovementInputWithViewRotationAsWorldRotation(float ScaleValue, bool bForce = false);
 
 
+	/**
+	 * Add forward and right input rotated for the plane made by X and Y vectors of view rotation, in one call.
+	 * @param Axis	Forward input in X and right input in Y.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity (Movement Input)", BlueprintCallable)
+		void AddPlanarMovementInput(FRotator WorldRotation, FVector2D Axis, bool bForce = false);
+
+	/**
+	 * Add forward and right input rotated for the sphere around view rotation, in one call.
+	 * @param Axis	Forward input in X and right input in Y.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity (Movement Input)", BlueprintCallable)
+		void AddRadialMovementInput(FRotator WorldRotation, FVector2D Axis, bool bForce = false);
+
+	/**
+	 * Add forward and right input rotated for the plane made by X and Y vectors of view rotation using view rotation as world rotation, in one call.
+	 * @param Axis	Forward input in X and right input in Y.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity (Movement Input)", BlueprintCallable)
+		void AddPlanarMovementInputWithViewRotationAsWorldRotation(FVector2D Axis, bool bForce = false);
+
+	/**
+	 * Add forward and right input rotated for the sphere around view rotation using view rotation as world rotation, in one call.
+	 * @param Axis	Forward input in X and right input in Y.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity (Movement Input)", BlueprintCallable)
+		void AddRadialMovementInputWithViewRotationAsWorldRotation(FVector2D Axis, bool bForce = false);
+
+	/**
+	 * The input basis of the view rotation around the vertical direction.
+	 * Rebuilt only when the view rotation (control rotation and view rotation base) or the vertical direction changes.
+	 */
+	const FDGMovementInputBasis& GetViewMovementInputBasis();
+
+	/** The dynamic gravity movement component. */
+	UDGCharacterMovementComponent* GetDGCharacterMovement() const { return DGCharacterMovement; }
+
+	virtual void PostInitializeComponents() override;
+
+	/**
+	 * Turns the view rotation base to its vertical direction at once, without smoothing.
+	 * This is the view update of the characters that are not locally viewed, and can be called when gameplay needs their view rotation.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintCallable)
+		void UpdateViewRotationBaseDirection();
+
+
 	/**
 	 * Calculate the vertical velocity of the character. The vertical velocity is a projection of the velocity on the vertical direction.
 	 * @return The vertical velocity of the Character.
@@ -182,10 +280,24 @@ public:
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
 		float HorizontalSpeed();
 
+	/**
+	 * All the velocities, speeds and gravity of the last movement tick in one call. Cheaper than the separate getters when several are needed.
+	 * @see UDGCharacterMovementComponent::GetKinematics
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		const FDGKinematicsSnapshot& GetKinematics() const;
+
 	/** The view rotation without control rotation.*/
 	UPROPERTY(Category = "View Rotation", BlueprintReadOnly)
 		FRotator ViewRotationBase;
 
+	/**
+	 * If true, remote players also update their view rotation base on a dedicated server.
+	 * Needed if gameplay reads their view rotation there. Locally controlled AI always updates it.
+	 */
+	UPROPERTY(Category = "View Rotation", EditAnywhere, BlueprintReadWrite)
+		bool bUpdateViewRotationOnDedicatedServer;
+
 	/** Intensity of the view adjustment. If the value negative, the adjustment is imediate.*/
 	UPROPERTY(Category = "View Rotation", EditAnywhere, BlueprintReadWrite)
 		float ViewRotationAdjustIntensity;
@@ -208,9 +320,19 @@ public:
 		if (NewViewRotationBaseMode == EViewRotationBaseMode::VRM_ControlRotation)
 		{
 			ViewRotationBase = FRotator();
+			ViewRotationBaseQuat = FQuat::Identity;
 		}
 	}
 
+	/** ViewRotationBase as a quaternion. */
+	const FQuat& GetViewRotationBaseQuat() const { return ViewRotationBaseQuat; }
+
+	/**
+	 * The view rotation as a quaternion, without the rotator conversions of GetViewRotation.
+	 * @return ViewRotationBase combined with the control rotation.
+	 */
+	FQuat GetViewQuat() const;
+
 	/**
 	 * Get the view rotation of the Character (direction they are looking, normally Controller->ControlRotation combined with ViewRotationBase).
 	 * @return The view rotation of the Character.
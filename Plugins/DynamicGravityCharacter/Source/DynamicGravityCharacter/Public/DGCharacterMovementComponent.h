@@ -4,8 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "DGFallPrediction.h"
+#include "DGFloorSnapshot.h"
+#include "DGKinematicsSnapshot.h"
+#include "DGSurfaceNavigationGraph.h"
 #include "DGCharacterMovementComponent.generated.h"
 
+class UDGAvoidanceSubsystem;
+class UDGMovementSettings;
+
 
 UENUM(BlueprintType)
 enum class EWalkableFloorNormalMode : uint8
@@ -41,6 +48,83 @@ enum class EPhysicsRotationVerticalDirectionMode : uint8
 	PRVDM_Custom					UMETA(DisplayName = "Custom")
 };
 
+/** The custom movement modes of UDGCharacterMovementComponent. */
+UENUM(BlueprintType)
+enum class EDGCustomMovementMode : uint8
+{
+	CMOVE_None					UMETA(Hidden),
+	CMOVE_Orbital				UMETA(DisplayName = "Orbital")
+};
+
+
+/** The gravity and the vertical direction of a tick, shared by the physics modes that don't change them while moving. */
+struct FDGGravityFrame
+{
+	/** The gravity acceleration. @see UDGCharacterMovementComponent::Gravity */
+	FVector Gravity;
+
+	/** The normalized gravity, zero if there is no gravity. */
+	FVector GravityDirection;
+
+	/** The vertical direction of the character. @see UDGCharacterMovementComponent::VerticalDirection */
+	FVector Up;
+
+	FDGGravityFrame()
+		: Gravity(FVector::ZeroVector)
+		, GravityDirection(FVector::ZeroVector)
+		, Up(FVector::UpVector)
+	{
+	}
+};
+
+
+/** The fields of UDGMovementSettings that a component keeps with its own values. */
+USTRUCT(BlueprintType)
+struct FDGMovementSettingsOverrides
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_WalkableFloorNormalMode : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_CustomWalkableFloorNormal : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_JumpDirectionMode : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_CustomJumpDirection : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_RotationAdjustIntensity : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_PhysicsRotationVerticalDirectionMode : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_CustomPhysicsRotationVerticalDirection : 1;
+
+	UPROPERTY(Category = "Overrides", EditAnywhere, BlueprintReadWrite)
+		uint8 bOverride_bIgnoreWorldGravityIfDynamicGravityIsNotZero : 1;
+
+	FDGMovementSettingsOverrides()
+		: bOverride_WalkableFloorNormalMode(false)
+		, bOverride_CustomWalkableFloorNormal(false)
+		, bOverride_JumpDirectionMode(false)
+		, bOverride_CustomJumpDirection(false)
+		, bOverride_RotationAdjustIntensity(false)
+		, bOverride_PhysicsRotationVerticalDirectionMode(false)
+		, bOverride_CustomPhysicsRotationVerticalDirection(false)
+		, bOverride_bIgnoreWorldGravityIfDynamicGravityIsNotZero(false)
+	{
+	}
+};
+
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FDGDirectionChangedSignature, UDGCharacterMovementComponent*, MovementComponent, FVector, NewDirection, FVector, OldDirection);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FDGGravityChangedSignature, UDGCharacterMovementComponent*, MovementComponent, FVector, NewGravity, FVector, OldGravity);
+
 
 /**
  *
@@ -96,28 +180,144 @@ class DYNAMICGRAVITYCHARACTER_API UDGCharacterMovementComponent : public UCharac
 		FVector CustomJumpDirection;
 
 
+	/** Query parameters reused by the floor and crouch queries. @see GetCachedCollisionParams */
+	mutable FCollisionQueryParams CachedCollisionQueryParams;
+
+	/** Response parameters reused by the floor and crouch queries. @see GetCachedCollisionParams */
+	mutable FCollisionResponseParams CachedCollisionResponseParams;
+
+	/** State of the owner when the cached collision parameters were built. */
+	mutable TWeakObjectPtr<const AActor> CachedCollisionOwner;
+	mutable TArray<AActor*> CachedMoveIgnoreActors;
+	mutable TArray<UPrimitiveComponent*> CachedMoveIgnoreComponents;
+	mutable FCollisionResponseContainer CachedCollisionResponses;
+	mutable TEnumAsByte<ECollisionChannel> CachedCollisionObjectType;
+	mutable FMaskFilter CachedMoveIgnoreMask;
+	mutable bool bCachedTraceComplexOnMove;
+	mutable bool bCachedReturnMaterialOnMove;
+	mutable bool bCachedCollisionParamsValid;
+
+
+	/** Surface that PhysNavWalking projects the character on. Refreshed by RefreshNavWalkingSurface. */
+	FVector NavWalkingSurfacePoint;
+	FVector NavWalkingSurfaceNormal;
+
+	/** The vertical direction used to find the nav walking surface. The surface is refreshed if the vertical direction changes. */
+	FVector NavWalkingSurfaceVerticalDirection;
+
+	/** Time since the nav walking surface was refreshed. */
+	float NavWalkingSurfaceAge;
+
+	bool bNavWalkingSurfaceValid;
+
+
+	/** CurrentFloor in the frame of its component, as it was last found. @see bCacheFloorInBaseFrame */
+	mutable TWeakObjectPtr<UPrimitiveComponent> BaseFloorComponent;
+	mutable FName BaseFloorBoneName;
+	mutable FVector BaseFloorCapsuleLocation;
+	mutable FVector BaseFloorLocation;
+	mutable FVector BaseFloorImpactPoint;
+	mutable FVector BaseFloorNormal;
+	mutable FVector BaseFloorImpactNormal;
+	mutable FVector BaseFloorUp;
+	mutable float BaseFloorDist;
+	mutable float BaseFloorLineDist;
+
+	/** The impact point last written to CurrentFloor from the cache. CurrentFloor was replaced by other code, as StepUp, if it differs. */
+	mutable FVector BaseFloorWrittenImpactPoint;
+	mutable bool bBaseFloorValid;
+
+	/** Smoothed normal of CurrentFloor, and the floor hit it was computed for. @see GetSmoothFloorImpactNormal */
+	mutable TWeakObjectPtr<UPrimitiveComponent> SmoothFloorNormalComponent;
+	mutable FVector SmoothFloorNormalPoint;
+	mutable int32 SmoothFloorNormalFaceIndex;
+	mutable FVector SmoothFloorNormal;
+
+
+	/** Substep of PhysFalling, computed by UpdateAdaptiveFallingTimeStep. */
+	float AdaptiveFallingTimeStep;
+
+	/** Gravity direction of the last falling update, to measure how fast the gravity turns. */
+	FVector LastFallingGravityNormal;
+
+	/** Sphere of the last clearance probe, free of blocking geometry. The radius is zero if the probe found geometry. @see EstimateFallClearance */
+	FVector FallClearanceCenter;
+	float FallClearanceRadius;
+	float FallClearanceProbeTime;
+	bool bFallClearanceValid;
+
+	/** Values of the last change notifications. @see NotifyGravityChanges */
+	FVector NotifiedVerticalDirection;
+	FVector NotifiedGravity;
+	FVector NotifiedWalkableNormal;
+	bool bNotifiedWalkableNormalValid;
+
+
 public:
 
 	UDGCharacterMovementComponent();
 
 
-	const FVector DEFAULT_GRAVITY_DIRECTION = FVector::UpVector;
+	static const FVector DEFAULT_GRAVITY_DIRECTION;
 
-	const EWalkableFloorNormalMode DEFAULT_WALKABLE_FLOOR_NORMAL_MODE = EWalkableFloorNormalMode::WFN_CharacterRotation;
-	const FVector DEFAULT_CUSTOM_WALKABLE_FLOOR_NORMAL = FVector::UpVector;
+	static constexpr EWalkableFloorNormalMode DEFAULT_WALKABLE_FLOOR_NORMAL_MODE = EWalkableFloorNormalMode::WFN_CharacterRotation;
+	static const FVector DEFAULT_CUSTOM_WALKABLE_FLOOR_NORMAL;
 
-	const EJumpDirectionMode DEFAULT_JUMP_DIRECTION_MODE = EJumpDirectionMode::JDM_Gravity;
-	const FVector DEFAULT_CUSTOM_JUMP_DIRECTION = FVector::UpVector;
+	static constexpr EJumpDirectionMode DEFAULT_JUMP_DIRECTION_MODE = EJumpDirectionMode::JDM_Gravity;
+	static const FVector DEFAULT_CUSTOM_JUMP_DIRECTION;
 
-	const EPhysicsRotationVerticalDirectionMode DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE = EPhysicsRotationVerticalDirectionMode::PRVDM_VerticalDirection;
+	static constexpr EPhysicsRotationVerticalDirectionMode DEFAULT_PHYSICS_ROTATION_VERTICAL_DIRECTION_MODE = EPhysicsRotationVerticalDirectionMode::PRVDM_VerticalDirection;
 
-	const FVector DEFAULT_VERTICAL_DIRECTION = FVector::UpVector;
+	static const FVector DEFAULT_VERTICAL_DIRECTION;
 
-	const float DEFAULT_LERP_ROTATION_RATE = 10.0f;
+	static constexpr float DEFAULT_LERP_ROTATION_RATE = 10.0f;
 
-	const FRotator DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION = FRotator::ZeroRotator;
+	static const FRotator DEFAULT_CUSTOM_VIEW_ROTATION_VERTICAL_DIRECTION;
 
-	const float VERTICAL_SLOPE_NORMAL_Z = 0.001f;
+	static constexpr float VERTICAL_SLOPE_NORMAL_Z = 0.001f;
+
+
+	/**
+	 * Shared dynamic gravity tunables. The component reads the values that are not overridden by MovementSettingsOverrides from this asset, through the Get accessors below,
+	 * so its own values of those fields are not used. Editing one of them in the editor overrides it.
+	 */
+	UPROPERTY(Category = "Character Movement (General Settings)", EditAnywhere, BlueprintReadOnly)
+		UDGMovementSettings* MovementSettings;
+
+	/** The fields of MovementSettings that this component keeps with its own values. */
+	UPROPERTY(Category = "Character Movement (General Settings)", EditAnywhere, BlueprintReadWrite)
+		FDGMovementSettingsOverrides MovementSettingsOverrides;
+
+	/**
+	 * Changes the shared settings.
+	 * @param NewMovementSettings	The new settings. If null, the component uses its own values.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintCallable)
+		void SetMovementSettings(UDGMovementSettings* NewMovementSettings) { MovementSettings = NewMovementSettings; }
+
+	/** The walkable floor normal mode in use, from MovementSettings unless overridden. @see WalkableFloorNormalMode */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		EWalkableFloorNormalMode GetWalkableFloorNormalMode() const;
+
+	/** The jump direction mode in use, from MovementSettings unless overridden. @see JumpDirectionMode */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		EJumpDirectionMode GetJumpDirectionMode() const;
+
+	/** The rotation adjust intensity in use, from MovementSettings unless overridden. @see RotationAdjustIntensity */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		float GetRotationAdjustIntensity() const;
+
+	/** The physics rotation vertical direction mode in use, from MovementSettings unless overridden. @see PhysicsRotationVerticalDirectionMode */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		EPhysicsRotationVerticalDirectionMode GetPhysicsRotationVerticalDirectionMode() const;
+
+	/** The rotation whose up vector is the custom physics rotation vertical direction, from MovementSettings unless overridden. @see PhysicsRotationVerticalDirectionMode */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FRotator GetCustomPhysicsRotationVerticalDirection() const;
+
+	/** Whether the world gravity is ignored while the dynamic gravity is not zero, from MovementSettings unless overridden. Always true while a surface path aligns the gravity. @see bIgnoreWorldGravityIfDynamicGravityIsNotZero */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		bool GetIgnoreWorldGravityIfDynamicGravityIsNotZero() const;
 
 
 
@@ -148,6 +348,21 @@ public:
 	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
 		FVector DynamicGravity;
 
+	/**
+	 * If true, the gravity fields of the world are sampled into FieldGravity every tick, and added to DynamicGravity.
+	 * @see UDGGravitySubsystem
+	 */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		bool bSampleGravityFields;
+
+	/** Gravity of the fields of the world at the character, sampled this tick. Zero if bSampleGravityFields is false. */
+	UPROPERTY(Category = "Dynamic Gravity", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector FieldGravity;
+
+	/** The dynamic part of the gravity: DynamicGravity plus FieldGravity. */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector GetDynamicGravity() const { return DynamicGravity + FieldGravity; }
+
 
 	/**
 	 * The walkable floor normal is the direction that the character finds the ground.
@@ -156,8 +371,21 @@ public:
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
 		FVector WalkableFloorNormal() const;
 
+	/**
+	 * If true and WalkableFloorNormalMode is 'Floor Impact Normal', the floor normal is interpolated from the smoothed vertex normals of the floor mesh,
+	 * so it doesn't jump at the edges of the triangles of curved surfaces. Needs a UDGSmoothNormalsUserData on the static mesh and complex collision.
+	 * @see UDGSmoothNormalsUserData
+	 */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite)
+		bool bSmoothFloorImpactNormal;
+
+	/** The impact normal of the current floor, smoothed if bSmoothFloorImpactNormal is true and the floor has smoothed normals. */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector GetSmoothFloorImpactNormal() const;
+
+	/** The custom walkable floor normal in use, from MovementSettings unless overridden. */
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintGetter)
-		FVector GetCustomWalkableFloorNormal() const { return CustomWalkableFloorNormal; }
+		FVector GetCustomWalkableFloorNormal() const;
 
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintSetter)
 		void SetCustomWalkableFloorNormal(FVector NewFloorDirection) { CustomWalkableFloorNormal = NewFloorDirection.GetSafeNormal(); }
@@ -169,8 +397,9 @@ public:
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
 		FVector JumpDirection() const;
 
+	/** The custom jump direction in use, from MovementSettings unless overridden. */
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintGetter)
-		FVector GetCustomJumpDirection() const { return CustomJumpDirection; }
+		FVector GetCustomJumpDirection() const;
 
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintSetter)
 		void SetCustomJumpDirection(FVector NewJumpDirection) { CustomJumpDirection = NewJumpDirection.GetSafeNormal(); }
@@ -180,9 +409,9 @@ public:
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
 		FVector WorldGravity() const { return  GetGravityZ() * DEFAULT_GRAVITY_DIRECTION; }
 
-	/** Calculate the vector that represents gravity. The combination of World Gravity and Dynamic Gravity. If bIgnoreWorldGravityIfDynamicGravityIsNotZero is true and DynamicGravity is not zero, then the value will be only DynamicGravity.*/
+	/** Calculate the vector that represents gravity. The combination of World Gravity and Dynamic Gravity. If bIgnoreWorldGravityIfDynamicGravityIsNotZero is true and Dynamic Gravity is not zero, then the value will be only Dynamic Gravity. @see GetDynamicGravity */
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
-		FVector Gravity() const { return (bIgnoreWorldGravityIfDynamicGravityIsNotZero && !DynamicGravity.Equals(FVector::ZeroVector)) ? DynamicGravity : WorldGravity() + DynamicGravity; }
+		FVector Gravity() const { const FVector Dynamic = GetDynamicGravity(); return (GetIgnoreWorldGravityIfDynamicGravityIsNotZero() && !Dynamic.Equals(FVector::ZeroVector)) ? Dynamic : WorldGravity() + Dynamic; }
 
 	/**
 	 * The vector that represents World Gravity nomalized. If GravityZ is negative, it's direction will be oposite of gravity direction.
@@ -196,7 +425,7 @@ public:
 	 * @see Gravity()
 	 */
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
-		FVector DynamicGravityNormal() const { return  DynamicGravity.GetSafeNormal(); }
+		FVector DynamicGravityNormal() const { return  GetDynamicGravity().GetSafeNormal(); }
 
 	/**
 	 * The vector that represents Gravity nomalized.
@@ -205,6 +434,14 @@ public:
 	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
 		FVector GravityNormal() const { return  Gravity().GetSafeNormal(); }
 
+	/**
+	 * The velocity and gravity of the last movement tick, split along the vertical direction.
+	 * The floor normals are evaluated by the first call after the tick.
+	 * @see FDGKinematicsSnapshot
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		const FDGKinematicsSnapshot& GetKinematics() const;
+
 
 	/**
 	* Sweeps a vertical trace to find the floor for the capsule at the given location. Will attempt to perch if ShouldComputePerchResult() returns true for the downward sweep result.
@@ -236,8 +473,263 @@ public:
 		virtual void ComputeFloorDist(const FVector WalkableNormal, const FRotator CapsuleRotation, FVector CapsuleLocation, float LineDistance, float SweepDistance, float SweepRadius, FFindFloorResult& FloorResult) const;
 
 
+	/** Graph used by MoveAlongSurface, for surfaces that the navmesh can't represent. */
+	UPROPERTY(Category = "Character Movement: NavMesh Movement", EditAnywhere, BlueprintReadWrite)
+		UDGSurfaceNavigationGraph* SurfaceNavigationGraph;
+
+	/** Distance, on the plane perpendicular to the vertical direction, to consider a surface path point reached. */
+	UPROPERTY(Category = "Character Movement: NavMesh Movement", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float SurfacePathAcceptanceRadius;
+
+	/** If true, DynamicGravity is turned to the local gravity of the surface path while following it. */
+	UPROPERTY(Category = "Character Movement: NavMesh Movement", EditAnywhere, BlueprintReadWrite)
+		bool bAlignGravityToSurfacePath;
+
+	/**
+	 * Finds a path in SurfaceNavigationGraph and follows it through RequestPathMove.
+	 * @param Goal	The goal location.
+	 * @return True if a path was found.
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		bool MoveAlongSurface(FVector Goal);
+
+	/** Stops following the surface path, and restores the gravity that the path changed. */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		void StopMovingAlongSurface();
+
+	/** Also stops following the surface path. */
+	virtual void StopActiveMovement() override;
+
+	/** Public as in UCharacterMovementComponent, so path following and external movers can call it. */
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintPure)
+		bool IsMovingAlongSurface() const { return SurfacePath.IsValid(); }
+
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintPure)
+		const FDGSurfacePath& GetSurfacePath() const { return SurfacePath; }
+
+
+	/**
+	 * If true, the velocity on ground is adjusted by ORCA avoidance in the plane perpendicular to the vertical direction, against the other characters that use it.
+	 * Works on walls and spheres, unlike bUseRVOAvoidance.
+	 * @see UDGAvoidanceSubsystem
+	 */
+	UPROPERTY(Category = "Character Movement: Avoidance", EditAnywhere, BlueprintReadOnly)
+		bool bUseTangentAvoidance;
+
+	/** Maximum distance of the characters considered by the tangent avoidance. */
+	UPROPERTY(Category = "Character Movement: Avoidance", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float AvoidanceConsiderationRadius;
+
+	/** How far ahead, in seconds, the tangent avoidance looks for collisions. */
+	UPROPERTY(Category = "Character Movement: Avoidance", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.01", UIMin = "0.01"))
+		float AvoidanceTimeHorizon;
+
+	/** Maximum number of nearest characters considered by the tangent avoidance. */
+	UPROPERTY(Category = "Character Movement: Avoidance", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1"))
+		int32 MaxAvoidanceNeighbors;
+
+	/**
+	 * Enables or disables the tangent avoidance.
+	 * @see bUseTangentAvoidance
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		void SetTangentAvoidanceEnabled(bool bEnable);
+
+
+	/**
+	 * If true, the substeps of PhysFalling are computed every frame instead of using MaxSimulationTimeStep.
+	 * They grow while the clearance around the capsule is large and the gravity is uniform, and shrink while the gravity direction or the path turns quickly.
+	 */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite)
+		bool bAdaptiveFallingSubsteps;
+
+	/** Maximum angle, in degrees, that the gravity direction or the path may turn in one falling substep. */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.1", UIMin = "0.1", EditCondition = "bAdaptiveFallingSubsteps"))
+		float MaxFallingTurnAnglePerSubstep;
+
+	/** Shortest adaptive falling substep. */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0166", ClampMax = "0.50", UIMin = "0.0166", UIMax = "0.50", EditCondition = "bAdaptiveFallingSubsteps"))
+		float MinFallingTimeStep;
+
+	/** Longest adaptive falling substep. */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0166", ClampMax = "0.50", UIMin = "0.0166", UIMax = "0.50", EditCondition = "bAdaptiveFallingSubsteps"))
+		float MaxFallingTimeStep;
+
+	/**
+	 * If true, PhysFalling moves the capsule without sweeping while the move stays inside the clearance around it.
+	 * The clearance sphere is probed again only when the capsule gets far from its center or it gets older than FallClearanceMaxAge.
+	 */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite)
+		bool bSkipFallSweepsInClearance;
+
+	/** Radius of the sphere around the capsule tested for geometry to estimate the falling clearance. @see EstimateFallClearance */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float FallClearanceProbeRadius;
+
+	/** Seconds a clearance probe is trusted, since moving geometry may enter the probed sphere. */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float FallClearanceMaxAge;
+
+	/** Forces the falling clearance to be probed again, as after a teleport. */
+	void InvalidateFallClearance() { bFallClearanceValid = false; }
+
+
+	/**
+	 * If true, a falling character high above the surface of a point gravity field switches to the orbital custom movement mode. Requires bSampleGravityFields.
+	 * The orbit is integrated with velocity Verlet, which keeps its energy over long horizons, and the capsule is swept only when it leaves the falling clearance.
+	 * @see EDGCustomMovementMode, UDGGravityFieldComponent::SurfaceRadius
+	 */
+	UPROPERTY(Category = "Character Movement: Orbital", EditAnywhere, BlueprintReadWrite)
+		bool bEnableOrbitalMovement;
+
+	/** Altitude above the surface of the dominant point field where a falling character starts orbiting. */
+	UPROPERTY(Category = "Character Movement: Orbital", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bEnableOrbitalMovement"))
+		float OrbitalEnterAltitude;
+
+	/** Altitude above the surface of the dominant point field where an orbiting character falls again. Clamped to OrbitalEnterAltitude. */
+	UPROPERTY(Category = "Character Movement: Orbital", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bEnableOrbitalMovement"))
+		float OrbitalExitAltitude;
+
+	/**
+	 * Maximum step of the orbit integration. Each move is split into equal steps no longer than this, and no state is carried across moves,
+	 * so a replayed or server move gives the same orbit as the client move.
+	 */
+	UPROPERTY(Category = "Character Movement: Orbital", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0166", ClampMax = "0.50", UIMin = "0.0166", UIMax = "0.50", EditCondition = "bEnableOrbitalMovement"))
+		float OrbitalTimeStep;
+
+	/**
+	 * The gravity at a location, with the gravity fields sampled there. @see Gravity()
+	 * @param Location	The world location.
+	 * @return The gravity acceleration.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector GravityAt(const FVector& Location) const;
+
+	/**
+	 * The altitude of a location above the surface of the dominant point field.
+	 * @param Location	The world location.
+	 * @return The altitude, or a negative value if no point field reaches the location.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		float GetOrbitalAltitude(const FVector& Location) const;
+
+	/**
+	 * Jumps with a root motion source in the gravity frame: Distance along Direction and Height along the vertical direction, whatever the world Z is.
+	 * @param InstanceName		Name of the root motion source.
+	 * @param Direction			Direction of the jump. Its vertical part is ignored.
+	 * @param Distance			Distance travelled along Direction.
+	 * @param Height			Height of the jump apex.
+	 * @param Duration			Duration of the jump.
+	 * @param bFinishOnLanded	If true, the jump ends when the character lands after the middle of the jump.
+	 * @return The ID of the root motion source.
+	 * @see FDGRootMotionSource_GravityJumpForce
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		int32 ApplyGravityJumpForce(FName InstanceName, FVector Direction, float Distance, float Height, float Duration, bool bFinishOnLanded = true);
+
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintPure)
+		bool IsOrbiting() const { return MovementMode == MOVE_Custom && CustomMovementMode == (uint8)EDGCustomMovementMode::CMOVE_Orbital; }
+
+
+	/**
+	 * If true, the floor on a moving or rotating base is kept in the frame of the base, and transformed with the base instead of found again.
+	 * This takes precedence over bAlwaysCheckFloor. A character that walks on the base slides the floor plane with it while it stays within BaseFloorCacheRadius
+	 * of where the floor was found, so the floor is only found again every few frames. The floor is always found again if it was an edge,
+	 * if the walkable floor normal turned in the frame of the base, or if the floor distance leaves the walking range.
+	 */
+	UPROPERTY(Category = "Character Movement: MovementBase", EditAnywhere, BlueprintReadWrite)
+		bool bCacheFloorInBaseFrame;
+
+	/** Maximum distance that the character may move in the frame of the base and still reuse its floor, whatever the floor shape. @see bCacheFloorInBaseFrame */
+	UPROPERTY(Category = "Character Movement: MovementBase", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bCacheFloorInBaseFrame"))
+		float BaseFloorCacheTolerance;
+
+	/**
+	 * Maximum distance, along the floor plane, that the character may walk from where the floor was found and still slide the floor plane with it.
+	 * A ledge closer than this may be found late by this distance. Zero reuses the floor only within BaseFloorCacheTolerance. @see bCacheFloorInBaseFrame
+	 */
+	UPROPERTY(Category = "Character Movement: MovementBase", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bCacheFloorInBaseFrame"))
+		float BaseFloorCacheRadius;
+
+	/** If true, DynamicGravity and VerticalDirection turn with the rotation of the movement base, as on a spinning station. */
+	UPROPERTY(Category = "Character Movement: MovementBase", EditAnywhere, BlueprintReadWrite)
+		bool bRotateDynamicGravityWithBase;
+
+
+	/** Called at the end of the tick when VerticalDirection turned more than VerticalDirectionChangeThreshold since the last call. */
+	UPROPERTY(Category = "Dynamic Gravity", BlueprintAssignable)
+		FDGDirectionChangedSignature OnVerticalDirectionChanged;
+
+	/** Called at the end of the tick when Gravity() turned more than GravityChangeAngleThreshold or changed more than GravityChangeMagnitudeThreshold since the last call. */
+	UPROPERTY(Category = "Dynamic Gravity", BlueprintAssignable)
+		FDGGravityChangedSignature OnGravityChanged;
+
+	/** Called at the end of the tick when WalkableFloorNormal() turned more than WalkableNormalChangeThreshold since the last call. */
+	UPROPERTY(Category = "Dynamic Gravity", BlueprintAssignable)
+		FDGDirectionChangedSignature OnWalkableNormalChanged;
+
+	/** Minimum angle, in degrees, that VerticalDirection turns before OnVerticalDirectionChanged is called. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180"))
+		float VerticalDirectionChangeThreshold;
+
+	/** Minimum angle, in degrees, that the gravity turns before OnGravityChanged is called. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180"))
+		float GravityChangeAngleThreshold;
+
+	/** Minimum change of the gravity magnitude before OnGravityChanged is called. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float GravityChangeMagnitudeThreshold;
+
+	/** Minimum angle, in degrees, that WalkableFloorNormal() turns before OnWalkableNormalChanged is called. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180"))
+		float WalkableNormalChangeThreshold;
+
+	/**
+	 * The velocity of the movement base at the feet, split along VerticalDirection.
+	 * bImpartBaseVelocityZ imparts the vertical part, and bImpartBaseVelocityX or bImpartBaseVelocityY the horizontal part.
+	 */
+	virtual FVector GetImpartedMovementBaseVelocity() const override;
+
+
+	/** Forces the cached collision parameters to be rebuilt by the next query. @see GetCachedCollisionParams */
+	void InvalidateCachedCollisionParams() { bCachedCollisionParamsValid = false; }
+
+
 protected:
 
+	/**
+	 * Collision query parameters built by InitCollisionParams, cached so the floor and crouch queries don't allocate a new ignore list every call.
+	 * They are rebuilt only when the owner, its move ignore lists, ignore mask, complex and material flags or its collision responses change. The matching response parameters are in CachedCollisionResponseParams.
+	 *
+	 * @param TraceTag	The tag of the query.
+	 * @return The cached query parameters.
+	 */
+	const FCollisionQueryParams& GetCachedCollisionParams(FName TraceTag) const;
+
+	/** Steers the character to the next point of the surface path. Called before the movement update. */
+	virtual void FollowSurfacePath(float DeltaTime);
+
+	/** Subsystem of the tangent avoidance, while registered. */
+	UPROPERTY(Transient)
+		UDGAvoidanceSubsystem* AvoidanceSubsystem;
+
+	/** Registers or unregisters with the avoidance subsystem, according to bUseTangentAvoidance. */
+	void UpdateTangentAvoidanceRegistration();
+
+	/** The path followed by MoveAlongSurface. */
+	FDGSurfacePath SurfacePath;
+
+	/** Index of the next point of SurfacePath. */
+	int32 SurfacePathIndex;
+
+	/** Gravity state before the surface path aligned the gravity, restored when the path ends. @see bAlignGravityToSurfacePath */
+	FVector SurfacePathSavedDynamicGravity;
+	FVector SurfacePathSavedVerticalDirection;
+	float SurfacePathGravityMagnitude;
+	bool bSurfacePathGravitySaved;
+
 	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
 	virtual FVector ConstrainInputAcceleration(const FVector& InputAcceleration) const override;
 
@@ -249,12 +741,77 @@ protected:
 	virtual FVector GetLedgeMove(const FVector& OldLocation, const FVector& Delta, const FVector& GravDir) const override;
 	virtual void ApplyAccumulatedForces(float DeltaSeconds) override;
 	void ApplyRootMotionToVelocity(float deltaTime);
+
+	/** Removes the gravity jump forces that finish on landing. */
+	void EndGravityJumpForcesOnLanded();
 	virtual void SetDefaultMovementMode() override;
+
+	/** Follows the movement base with the full rotation of the base, and keeps the feet, not the world Z offset, on it. */
+	virtual void UpdateBasedMovement(float DeltaSeconds) override;
+
+	/** Keeps the pitch and the roll of the base rotation, that are relative to the gravity, not to the world. */
+	virtual void UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation) override;
+
+	/**
+	 * Stores CurrentFloor in the frame of its component. @see bCacheFloorInBaseFrame
+	 * @param CapsuleLocation	The capsule location the floor was found from.
+	 * @param WalkableNormal	The walkable floor normal the floor was found along.
+	 */
+	void CacheFloorInBaseFrame(const FVector& CapsuleLocation, const FVector& WalkableNormal) const;
+
+	/**
+	 * Moves CurrentFloor with its component, and slides its plane with the capsule if the capsule walked on it.
+	 * @param CapsuleLocation	The capsule location.
+	 * @param WalkableNormal	The walkable floor normal the floor would be found along.
+	 * @return True if CurrentFloor is still valid.
+	 */
+	bool RefreshFloorFromBaseFrame(const FVector& CapsuleLocation, const FVector& WalkableNormal) const;
 	virtual void MoveSmooth(const FVector& InVelocity, const float DeltaSeconds, FStepDownResult* OutStepDownResult = NULL) override;
 	virtual void SimulateMovement(float DeltaTime) override;
+	virtual void PerformMovement(float DeltaTime) override;
 
 	void PhysWalking(float deltaTime, int32 Iterations) override;
 
+	/**
+	 * If true, PhysWalking rebuilds the full old floor and calls the FFindFloorResult versions of ShouldCatchAir and CheckFall.
+	 * Subclasses that override those set it in their constructor; otherwise the walking loop decides from the floor snapshot.
+	 */
+	uint8 bUseFullOldFloor : 1;
+
+	/**
+	 * Whether the character should start falling when walking from OldFloor to NewFloor. Used by PhysWalking, which only keeps a snapshot of the old floor.
+	 * False, as UCharacterMovementComponent::ShouldCatchAir, unless bUseFullOldFloor is set.
+	 * @param OldFloor	Snapshot of the floor before the move.
+	 * @param NewFloor	The floor after the move.
+	 * @return True if the character should fall.
+	 */
+	virtual bool ShouldCatchAir(const FDGFloorSnapshot& OldFloor, const FFindFloorResult& NewFloor);
+	using UCharacterMovementComponent::ShouldCatchAir;
+
+	/**
+	 * Walks off a ledge from the old floor snapshot, as UCharacterMovementComponent::CheckFall. Forwards to it with the rebuilt floor if bUseFullOldFloor is set.
+	 * @return True if the character started falling.
+	 */
+	virtual bool CheckFall(const FDGFloorSnapshot& OldFloor, const FHitResult& Hit, const FVector& Delta, const FVector& OldLocation, float remainingTime, float timeTick, int32 Iterations, bool bMustJump);
+	using UCharacterMovementComponent::CheckFall;
+
+	/** Reverts a walking move to the old location. The floor is only rebuilt from its snapshot if the old base is restored. @see UCharacterMovementComponent::RevertMove */
+	void RevertMove(const FVector& OldLocation, UPrimitiveComponent* OldBase, const FVector& InOldBaseLocation, const FDGFloorSnapshot& OldFloor, bool bFailMove);
+
+	/**
+	 * Walking without floor sweeps. The velocity is kept on the plane perpendicular to VerticalDirection and the feet are projected on the cached nav walking surface along VerticalDirection.
+	 * The surface is found by a single line trace, refreshed every NavMeshProjectionInterval, when the character leaves the sampled area or when the vertical direction changes.
+	 * The character starts falling if no walkable surface is found.
+	 */
+	virtual void PhysNavWalking(float deltaTime, int32 Iterations) override;
+
+	/**
+	 * Line traces along -VerticalDirection from the feet location to find the nav walking surface.
+	 * @param FeetLocation	The bottom of the capsule. @see GetGravityFeetLocation
+	 * @return True if a walkable surface was found.
+	 */
+	virtual bool RefreshNavWalkingSurface(const FVector& FeetLocation);
+
 	virtual FVector ComputeGroundMovementDelta(const FVector& Delta, const FHitResult& RampHit, const bool bHitFromLineTrace) const override;
 	virtual float SlideAlongSurface(const FVector& Delta, float Time, const FVector& Normal, FHitResult& Hit, bool bHandleImpact) override;
 	virtual void MoveAlongFloor(const FVector& InVelocity, float DeltaSeconds, FStepDownResult* OutStepDownResult = NULL) override;
@@ -266,6 +823,70 @@ protected:
 	virtual void PhysFalling(float DeltaTime, int32 Iterations) override;
 
 	virtual FVector GetFallingLateralAcceleration(float DeltaTime) override;
+
+	/**
+	 * Conservative distance from the capsule to the nearest geometry, used by the adaptive falling substeps and bSkipFallSweepsInClearance.
+	 * The probed sphere is cached, and only probed again when needed.
+	 * @return The clearance, zero if geometry may be near.
+	 */
+	virtual float EstimateFallClearance();
+
+	/**
+	 * The clearance of a capsule location inside the cached clearance sphere, without probing.
+	 * @param CapsuleLocation	The capsule center.
+	 * @return The clearance, zero if the location is outside the sphere or there is no valid probe.
+	 */
+	float GetCachedFallClearance(const FVector& CapsuleLocation) const;
+
+	/** Computes AdaptiveFallingTimeStep from the clearance and from the turn rate of the gravity direction and of the path. */
+	void UpdateAdaptiveFallingTimeStep(float DeltaTime);
+
+	/** Refreshes GravityFrame. Called each tick after UpdateVerticalDirection, and again at the start of each performed or simulated move, after the gravity may have changed. */
+	void UpdateGravityFrame();
+
+	/**
+	 * Calls the change delegates whose values changed more than their thresholds since their last call.
+	 * Called once at the end of the tick, so each delegate is called at most once per frame.
+	 */
+	void NotifyGravityChanges();
+
+	/** Flying in the gravity frame: steps up along GravityFrame.Up instead of the world Z. */
+	virtual void PhysFlying(float deltaTime, int32 Iterations) override;
+
+	/** Swimming in the gravity frame: buoyancy, surface damping and step up along GravityFrame.Up instead of the world Z. */
+	virtual void PhysSwimming(float deltaTime, int32 Iterations) override;
+
+	/** Gravity frame of the current tick. @see UpdateGravityFrame */
+	FDGGravityFrame GravityFrame;
+
+	/** Refreshes Kinematics. Called once at the end of the tick. */
+	void UpdateKinematics();
+
+	/** Evaluates the walkable and floor normals of Kinematics, which only some consumers read. */
+	void UpdateKinematicsNormals() const;
+
+	/** Kinematics of the last tick. @see GetKinematics */
+	mutable FDGKinematicsSnapshot Kinematics;
+	mutable bool bKinematicsNormalsValid;
+
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+
+	/** Orbits the dominant point field with velocity Verlet in steps of up to OrbitalTimeStep, and falls again near its surface. */
+	virtual void PhysOrbital(float DeltaTime, int32 Iterations);
+
+	/**
+	 * Leaves the orbital mode and falls for the simulated time that the orbit didn't consume.
+	 * @param DeltaTime		Time left to simulate.
+	 * @param Iterations	Physics iterations already done this frame.
+	 */
+	void StopOrbiting(float DeltaTime, int32 Iterations);
+
+	/** The exit altitude of the orbital mode, never above the enter altitude. */
+	FORCEINLINE float GetOrbitalExitAltitude() const { return FMath::Min(OrbitalExitAltitude, OrbitalEnterAltitude); }
+
+	/** True if the falling character is high enough above a point field to orbit it. */
+	virtual bool ShouldStartOrbiting() const;
+
 	virtual bool DoJump(bool bReplayingMoves) override;
 	virtual void JumpOff(AActor* MovementBaseActor) override;
 	float BoostAirControl(float DeltaTime, float TickAirControl, const FVector& FallAcceleration) override;
@@ -274,6 +895,52 @@ protected:
 public:
 
 	virtual bool IsValidLandingSpot(const FVector& CapsuleLocation, const FHitResult& Hit) const override;
+	virtual float GetSimulationTimeStep(float RemainingTime, int32 Iterations) const override;
+	virtual FVector ConstrainAnimRootMotionVelocity(const FVector& RootMotionVelocity, const FVector& CurrentVelocity) const override;
+
+	/** The immersion in water, measured along VerticalDirection. @return 0 out of water, 1 fully immersed. */
+	virtual float ImmersionDepth() const override;
+
+	/**
+	 * The bottom of the capsule along VerticalDirection. Unlike GetActorFeetLocation, it doesn't assume that the world Z is up.
+	 * @return The feet location.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector GetGravityFeetLocation() const;
+
+	/**
+	 * Snapshot of the current floor, without the full hit result.
+	 * @return The current floor snapshot.
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintPure)
+		FDGFloorSnapshot GetCurrentFloorSnapshot() const { return FDGFloorSnapshot(CurrentFloor); }
+
+	/**
+	 * Predicts the fall of the capsule under Gravity() and the air control, without moving it.
+	 * The path is integrated analytically between sparse capsule sweeps, with the gravity assumed constant along each sweep.
+	 * If bSampleGravityFields is true, the gravity fields are sampled at the start of each sweep.
+	 * @param Params		The starting state of the fall.
+	 * @param OutResult		The surface hit, when it was hit, and the path.
+	 * @return True if a surface was hit within Params.MaxSimTime.
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		bool PredictFallTrajectory(const FDGFallPredictionParams& Params, FDGFallPredictionResult& OutResult) const;
+
+	/**
+	 * Predicts the fall from the current location, velocity and acceleration.
+	 * @see PredictFallTrajectory
+	 */
+	UFUNCTION(Category = "Pawn|Components|CharacterMovement", BlueprintCallable)
+		bool PredictCurrentFallTrajectory(float MaxSimTime, FDGFallPredictionResult& OutResult) const;
+
+	/**
+	 * Predicts many falls of this capsule in lockstep, as for the jump candidates of an AI or the landing markers of a UI.
+	 * The gravity fields of all the falls are sampled in one pass per sweep step.
+	 * @param Params		The starting states of the falls.
+	 * @param OutResults	The result of each fall.
+	 * @see PredictFallTrajectory
+	 */
+	void PredictFallTrajectories(const TArray<FDGFallPredictionParams>& Params, TArray<FDGFallPredictionResult>& OutResults) const;
 
 
 	virtual bool IsWalkable(const FHitResult& Hit) const override;
@@ -303,5 +970,12 @@ public:
 
 
 
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 };
\ No newline at end of file
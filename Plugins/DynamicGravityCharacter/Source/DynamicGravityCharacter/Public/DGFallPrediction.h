@@ -0,0 +1,107 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DGFallPrediction.generated.h"
+
+
+/** The starting state of a fall predicted by UDGCharacterMovementComponent::PredictFallTrajectory. */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGFallPredictionParams
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Location of the capsule center. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite)
+		FVector StartLocation;
+
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite)
+		FVector StartVelocity;
+
+	/** Input acceleration held during the fall. Only its part perpendicular to the gravity is used, scaled by the air control. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite)
+		FVector InputAcceleration;
+
+	/** Maximum simulated time, in seconds. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float MaxSimTime;
+
+	/** Longest time between two sweeps. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.01", UIMin = "0.01"))
+		float MaxSweepInterval;
+
+	/** Maximum distance between the curved path and the straight sweep that approximates it. Shorter sweeps are used where the path bends more. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.1", UIMin = "0.1"))
+		float MaxChordError;
+
+	/** Maximum number of sweeps. */
+	UPROPERTY(Category = "Fall Prediction", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1"))
+		int32 MaxSweeps;
+
+	FDGFallPredictionParams()
+		: StartLocation(ForceInitToZero)
+		, StartVelocity(ForceInitToZero)
+		, InputAcceleration(ForceInitToZero)
+		, MaxSimTime(3.f)
+		, MaxSweepInterval(0.25f)
+		, MaxChordError(5.f)
+		, MaxSweeps(32)
+	{
+	}
+};
+
+
+/** The result of a fall predicted by UDGCharacterMovementComponent::PredictFallTrajectory. */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGFallPredictionResult
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Location of the capsule center when it hit a surface, or at the end of the simulated time. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector LandingLocation;
+
+	/** Location of the contact with the surface. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector ImpactPoint;
+
+	/** Normal of the surface. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector ImpactNormal;
+
+	/** Velocity when the surface was hit. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector LandingVelocity;
+
+	/** Time, from the start of the fall, when the surface was hit. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		float LandingTime;
+
+	/** The capsule centers along the path, one per sweep, starting at the start location. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		TArray<FVector> PathPoints;
+
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		int32 NumSweeps;
+
+	/** True if a surface was hit. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bHit : 1;
+
+	/** True if the surface hit is walkable under the gravity at the hit. */
+	UPROPERTY(Category = "Fall Prediction", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bWalkable : 1;
+
+	FDGFallPredictionResult()
+		: LandingLocation(FVector::ZeroVector)
+		, ImpactPoint(FVector::ZeroVector)
+		, ImpactNormal(FVector::ZeroVector)
+		, LandingVelocity(FVector::ZeroVector)
+		, LandingTime(0.f)
+		, NumSweeps(0)
+		, bHit(false)
+		, bWalkable(false)
+	{
+	}
+};
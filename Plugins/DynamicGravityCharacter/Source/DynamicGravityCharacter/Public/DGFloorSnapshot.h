@@ -0,0 +1,109 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "DGFloorSnapshot.generated.h"
+
+
+/**
+ * Compact copy of a FFindFloorResult with only what the walking loop needs to revert a move or walk off a ledge.
+ * The full hit result is only rebuilt when ToFloorResult() is called.
+ */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGFloorSnapshot
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The distance to the floor, computed from the swept capsule trace. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		float FloorDist;
+
+	/** The distance to the floor, computed from the trace. Only valid if bLineTrace is true. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		float LineDist;
+
+	/** Normal of the floor surface. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector ImpactNormal;
+
+	/** Normal of the capsule at the floor contact. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector Normal;
+
+	/** Location of the contact with the floor. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector ImpactPoint;
+
+	/** Location of the capsule when it touched the floor. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector Location;
+
+	/** The floor component. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+
+	/** The floor bone, if the floor is a skeletal mesh. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		FName BoneName;
+
+	/** True if there was a blocking hit in the floor test. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bBlockingHit : 1;
+
+	/** True if the hit found a valid walkable floor. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bWalkableFloor : 1;
+
+	/** True if the hit found a valid walkable floor using a line trace (rather than a sweep test, which happens when the sweep test fails to yield a walkable surface). */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bLineTrace : 1;
+
+	/** True if the floor test started in penetration. */
+	UPROPERTY(Category = "Floor", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bStartPenetrating : 1;
+
+	FDGFloorSnapshot()
+		: FloorDist(0.f)
+		, LineDist(0.f)
+		, ImpactNormal(FVector::ZeroVector)
+		, Normal(FVector::ZeroVector)
+		, ImpactPoint(FVector::ZeroVector)
+		, Location(FVector::ZeroVector)
+		, BoneName(NAME_None)
+		, bBlockingHit(false)
+		, bWalkableFloor(false)
+		, bLineTrace(false)
+		, bStartPenetrating(false)
+	{
+	}
+
+	explicit FDGFloorSnapshot(const FFindFloorResult& Floor)
+		: FloorDist(Floor.FloorDist)
+		, LineDist(Floor.LineDist)
+		, ImpactNormal(Floor.HitResult.ImpactNormal)
+		, Normal(Floor.HitResult.Normal)
+		, ImpactPoint(Floor.HitResult.ImpactPoint)
+		, Location(Floor.HitResult.Location)
+		, Component(Floor.HitResult.Component)
+		, BoneName(Floor.HitResult.BoneName)
+		, bBlockingHit(Floor.bBlockingHit)
+		, bWalkableFloor(Floor.bWalkableFloor)
+		, bLineTrace(Floor.bLineTrace)
+		, bStartPenetrating(Floor.HitResult.bStartPenetrating)
+	{
+	}
+
+	/** Returns true if the floor result hit a walkable surface. */
+	bool IsWalkableFloor() const
+	{
+		return bBlockingHit && bWalkableFloor;
+	}
+
+	/** Rebuilds the hit result of the floor. Fields that are not part of the snapshot (like the face index and the physical material) are left with their defaults. */
+	FHitResult ToHitResult() const;
+
+	/** Rebuilds the full floor result. */
+	FFindFloorResult ToFloorResult() const;
+};
@@ -0,0 +1,66 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "DGGravityFieldComponent.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EGravityFieldType : uint8
+{
+	GFT_Directional				UMETA(DisplayName = "Directional"),
+	GFT_Point					UMETA(DisplayName = "Point")
+};
+
+
+/**
+ * A source of dynamic gravity. The gravity of a location is the sum of the fields that reach it.
+ * @see UDGGravitySubsystem
+ */
+UCLASS(ClassGroup = (DynamicGravity), meta = (BlueprintSpawnableComponent))
+class DYNAMICGRAVITYCHARACTER_API UDGGravityFieldComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGGravityFieldComponent();
+
+	/**
+	 * The field type.
+	 *    - Directional:  Pulls along the negative up vector of the component.
+	 *    - Point:  Pulls to the location of the component.
+	 */
+	UPROPERTY(Category = "Gravity Field", EditAnywhere, BlueprintReadWrite)
+		EGravityFieldType FieldType;
+
+	/** Acceleration of the field, in cm/s². For point fields with inverse square falloff, it's the acceleration at SurfaceRadius. */
+	UPROPERTY(Category = "Gravity Field", EditAnywhere, BlueprintReadWrite)
+		float Strength;
+
+	/** Distance from the component reached by the field. Zero means infinite. */
+	UPROPERTY(Category = "Gravity Field", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"))
+		float Radius;
+
+	/** Radius of the body of a point field. */
+	UPROPERTY(Category = "Gravity Field", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", EditCondition = "FieldType == EGravityFieldType::GFT_Point"))
+		float SurfaceRadius;
+
+	/** If true, the acceleration of a point field decreases with the square of the distance beyond SurfaceRadius, like a point mass. */
+	UPROPERTY(Category = "Gravity Field", EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "FieldType == EGravityFieldType::GFT_Point"))
+		bool bInverseSquareFalloff;
+
+
+	/**
+	 * The gravity of this field at a location.
+	 * @param Location	The world location.
+	 * @return The gravity acceleration, zero if the location is out of the field.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector SampleGravity(const FVector& Location) const;
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+};
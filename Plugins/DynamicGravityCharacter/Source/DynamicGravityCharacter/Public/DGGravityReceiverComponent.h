@@ -0,0 +1,92 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "DGGravityReceiverComponent.generated.h"
+
+struct FBodyInstance;
+
+
+/**
+ * Applies dynamic gravity to the simulating bodies of its owner, ragdolls included, instead of the world gravity.
+ * From BeginPlay, the world gravity is disabled on the bodies, and UDGGravitySubsystem applies the gravity of all the receivers in one pass before each physics scene tick.
+ * Only the bodies that had the world gravity enabled receive the dynamic gravity, and the gravity flag of each body is restored when the receiver stops.
+ * @see UDGGravitySubsystem
+ */
+UCLASS(ClassGroup = (DynamicGravity), meta = (BlueprintSpawnableComponent))
+class DYNAMICGRAVITYCHARACTER_API UDGGravityReceiverComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGGravityReceiverComponent();
+
+	/** Dynamic gravity added to the sampled gravity fields. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		FVector DynamicGravity;
+
+	/** Despises World Gravity if Dynamic Gravity Is Differernt of zero. @see UDGCharacterMovementComponent::bIgnoreWorldGravityIfDynamicGravityIsNotZero */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		bool bIgnoreWorldGravityIfDynamicGravityIsNotZero;
+
+	/** Scale of the applied gravity. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		float GravityScale;
+
+	/** If set, only this primitive receives the gravity. Otherwise, all the primitives of the owner. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		UPrimitiveComponent* TargetPrimitive;
+
+
+	/**
+	 * Adds the simulating bodies that receive the gravity to OutBodies.
+	 * Bodies created after the receiver started, as the bodies of a new ragdoll, have their gravity flag saved and disabled here.
+	 */
+	void GatherSimulatingBodies(TArray<FBodyInstance*>& OutBodies);
+
+	/**
+	 * Combines the world gravity with the dynamic gravity. @see UDGCharacterMovementComponent::Gravity
+	 * @param FieldGravity	The gravity fields sampled at the body.
+	 * @return The gravity acceleration of the body.
+	 */
+	FVector CombineGravity(const FVector& FieldGravity) const;
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+
+protected:
+
+	/** Registers to UDGGravitySubsystem and disables the world gravity on the target primitives. */
+	void StartReceiving();
+
+	/** Unregisters from UDGGravitySubsystem and restores the gravity flags of the target primitives. */
+	void StopReceiving();
+
+	/** Disables the world gravity on the bodies of the target primitives, saving their flags in SavedGravityEnabled. */
+	void DisableWorldGravity();
+
+	/** Restores the gravity flags saved by DisableWorldGravity and GatherSimulatingBodies. */
+	void RestoreWorldGravity();
+
+	/**
+	 * Saves the gravity flag of a body the first time it is seen, and disables its world gravity.
+	 * @return True if the body had the world gravity enabled, so it receives the dynamic gravity.
+	 */
+	bool TakeOverBodyGravity(UPrimitiveComponent* Primitive, int32 BodyIndex, FBodyInstance* Body);
+
+	/** The body of a primitive. BodyIndex is the index in the bodies of a skeletal mesh, or INDEX_NONE for the body of other primitives. */
+	static FBodyInstance* GetBody(UPrimitiveComponent* Primitive, int32 BodyIndex);
+
+	typedef TPair<TWeakObjectPtr<UPrimitiveComponent>, int32> FBodyKey;
+
+	/** The original gravity flag of each body whose gravity was disabled, by primitive and body index. */
+	TMap<FBodyKey, bool> SavedGravityEnabled;
+
+	bool bReceiving;
+};
@@ -0,0 +1,109 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicsInterfaceDeclaresCore.h"
+#include "DGGravityFieldComponent.h"
+#include "DGGravitySubsystem.generated.h"
+
+struct FBodyInstance;
+class UDGGravityReceiverComponent;
+class UDGProjectileMovementComponent;
+
+
+/**
+ * Keeps the gravity fields of a world and samples the dynamic gravity of locations.
+ * @see UDGGravityFieldComponent
+ */
+UCLASS()
+class DYNAMICGRAVITYCHARACTER_API UDGGravitySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void RegisterField(UDGGravityFieldComponent* Field);
+	void UnregisterField(UDGGravityFieldComponent* Field);
+
+	const TArray<UDGGravityFieldComponent*>& GetFields() const { return Fields; }
+
+	/**
+	 * The dynamic gravity at a location, the sum of the fields that reach it.
+	 * @param Location	The world location.
+	 * @return The gravity acceleration.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector SampleGravity(const FVector& Location) const;
+
+	/**
+	 * The point field that pulls a location the hardest, as the body that a character orbits.
+	 * @param Location	The world location.
+	 * @return The field, or null if no point field reaches the location.
+	 */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		UDGGravityFieldComponent* FindDominantPointField(const FVector& Location) const;
+
+	/**
+	 * The dynamic gravity of many locations in one pass. The field parameters are read once, and each field is applied to all the locations.
+	 * @param Locations		The world locations.
+	 * @param Num			Number of locations.
+	 * @param OutGravity	The gravity of each location. Must have room for Num vectors.
+	 */
+	void SampleGravityBatch(const FVector* Locations, int32 Num, FVector* OutGravity) const;
+
+	void SampleGravityBatch(const TArray<FVector>& Locations, TArray<FVector>& OutGravity) const
+	{
+		OutGravity.SetNumUninitialized(Locations.Num());
+		SampleGravityBatch(Locations.GetData(), Locations.Num(), OutGravity.GetData());
+	}
+
+
+	void RegisterProjectile(UDGProjectileMovementComponent* Projectile);
+	void UnregisterProjectile(UDGProjectileMovementComponent* Projectile);
+
+	/**
+	 * Samples the gravity of all the registered projectiles in one pass, at their current locations and at the locations predicted for the end of the frame.
+	 * Only the first call of a frame does the work.
+	 * @param DeltaTime	The frame time used for the prediction.
+	 */
+	void UpdateProjectileGravity(float DeltaTime);
+
+
+	/** Registers a receiver, and binds the receiver pass to the physics scene if it isn't bound yet. Receivers register from BeginPlay, when the scene exists. */
+	void RegisterReceiver(UDGGravityReceiverComponent* Receiver);
+	void UnregisterReceiver(UDGGravityReceiverComponent* Receiver);
+
+	virtual void Deinitialize() override;
+
+
+private:
+
+	/**
+	 * Applies the gravity of all the simulating bodies of the receivers before the physics scene ticks.
+	 * The gravity is sampled in one pass and applied as an acceleration, so it is spread over the physics substeps.
+	 * @param PhysScene		The ticking physics scene.
+	 * @param DeltaTime		The time simulated by the scene.
+	 */
+	void ApplyReceiverGravity(FPhysScene* PhysScene, float DeltaTime);
+
+	UPROPERTY(Transient)
+		TArray<UDGGravityFieldComponent*> Fields;
+
+	TArray<TWeakObjectPtr<UDGProjectileMovementComponent>> Projectiles;
+	uint64 ProjectileGravityFrame = 0;
+
+	/** Scratch buffers of UpdateProjectileGravity. The first half are the current locations, the second half the predicted ones. */
+	TArray<FVector> ProjectileLocations;
+	TArray<FVector> ProjectileGravity;
+
+	TArray<TWeakObjectPtr<UDGGravityReceiverComponent>> Receivers;
+	FDelegateHandle PhysScenePreTickHandle;
+
+	/** Scratch buffers of ApplyReceiverGravity. */
+	TArray<FBodyInstance*> ReceiverBodies;
+	TArray<int32> ReceiverBodyOwners;
+	TArray<FVector> ReceiverLocations;
+	TArray<FVector> ReceiverGravity;
+};
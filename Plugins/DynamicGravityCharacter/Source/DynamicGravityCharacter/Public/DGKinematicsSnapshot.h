@@ -0,0 +1,88 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "DGKinematicsSnapshot.generated.h"
+
+
+/**
+ * Velocity and gravity of a dynamic gravity character, split along its vertical direction.
+ * Refreshed once at the end of each movement tick, so Blueprints read all of it in one call instead of recomputing each projection.
+ * WalkableFloorNormal and FloorNormal are only evaluated when the snapshot is read.
+ * @see UDGCharacterMovementComponent::GetKinematics
+ */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGKinematicsSnapshot
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector Velocity;
+
+	/** Velocity perpendicular to VerticalDirection. */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector HorizontalVelocity;
+
+	/** Velocity along VerticalDirection. */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector VerticalVelocity;
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		float Speed;
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		float HorizontalSpeed;
+
+	/** Size of VerticalVelocity. */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		float VerticalSpeed;
+
+	/** @see UDGCharacterMovementComponent::VerticalDirection */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector VerticalDirection;
+
+	/** @see UDGCharacterMovementComponent::Gravity */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector Gravity;
+
+	/** @see UDGCharacterMovementComponent::GravityNormal */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector GravityNormal;
+
+	/** @see UDGCharacterMovementComponent::WalkableFloorNormal */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector WalkableFloorNormal;
+
+	/** Normal of the floor surface, or VerticalDirection without a walkable floor. @see UDGCharacterMovementComponent::GetSmoothFloorImpactNormal */
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		FVector FloorNormal;
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		TEnumAsByte<EMovementMode> MovementMode;
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsMovingOnGround : 1;
+
+	UPROPERTY(Category = "Kinematics", VisibleInstanceOnly, BlueprintReadOnly)
+		uint8 bIsFalling : 1;
+
+	FDGKinematicsSnapshot()
+		: Velocity(ForceInitToZero)
+		, HorizontalVelocity(ForceInitToZero)
+		, VerticalVelocity(ForceInitToZero)
+		, Speed(0.f)
+		, HorizontalSpeed(0.f)
+		, VerticalSpeed(0.f)
+		, VerticalDirection(FVector::UpVector)
+		, Gravity(ForceInitToZero)
+		, GravityNormal(ForceInitToZero)
+		, WalkableFloorNormal(ForceInitToZero)
+		, FloorNormal(FVector::UpVector)
+		, MovementMode(MOVE_None)
+		, bIsMovingOnGround(false)
+		, bIsFalling(false)
+	{
+	}
+};
@@ -0,0 +1,85 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * VectorRegister kernels for the gravity relative math used all over the plugin.
+ * The vertical component of a vector is its projection on a normalized vertical direction, and the horizontal component is the rest.
+ */
+struct DYNAMICGRAVITYCHARACTER_API FDGMath
+{
+	/** Projection of Vector on the normalized Direction. Same as Vector.ProjectOnToNormal(Direction). */
+	static FORCEINLINE FVector VerticalComponent(const FVector& Vector, const FVector& Direction)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vector);
+		const VectorRegister N = VectorLoadFloat3_W0(&Direction);
+
+		FVector Result;
+		VectorStoreFloat3(VectorMultiply(N, VectorDot3(V, N)), &Result);
+		return Result;
+	}
+
+	/** Vector minus its projection on the normalized Direction. Same as Vector - Vector.ProjectOnToNormal(Direction). */
+	static FORCEINLINE FVector HorizontalComponent(const FVector& Vector, const FVector& Direction)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vector);
+		const VectorRegister N = VectorLoadFloat3_W0(&Direction);
+
+		FVector Result;
+		VectorStoreFloat3(VectorSubtract(V, VectorMultiply(N, VectorDot3(V, N))), &Result);
+		return Result;
+	}
+
+	/** Splits Vector in its vertical and horizontal components related to the normalized Direction. */
+	static FORCEINLINE void Decompose(const FVector& Vector, const FVector& Direction, FVector& OutVertical, FVector& OutHorizontal)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vector);
+		const VectorRegister N = VectorLoadFloat3_W0(&Direction);
+		const VectorRegister Vertical = VectorMultiply(N, VectorDot3(V, N));
+
+		VectorStoreFloat3(Vertical, &OutVertical);
+		VectorStoreFloat3(VectorSubtract(V, Vertical), &OutHorizontal);
+	}
+
+	/** Normalized horizontal component of Vector, or zero if it is too small. Same as (Vector - Vector.ProjectOnToNormal(Direction)).GetSafeNormal(). */
+	static FORCEINLINE FVector HorizontalDirection(const FVector& Vector, const FVector& Direction)
+	{
+		const VectorRegister V = VectorLoadFloat3_W0(&Vector);
+		const VectorRegister N = VectorLoadFloat3_W0(&Direction);
+
+		FVector Result;
+		VectorStoreFloat3(SafeNormalize(VectorSubtract(V, VectorMultiply(N, VectorDot3(V, N)))), &Result);
+		return Result;
+	}
+
+	/** Normalized vector, or zero if it is too small. Same as FVector::GetSafeNormal(). */
+	static FORCEINLINE VectorRegister SafeNormalize(const VectorRegister& Vector)
+	{
+		const VectorRegister SizeSquared = VectorDot3(Vector, Vector);
+		const VectorRegister NonZeroMask = VectorCompareGT(SizeSquared, VectorSetFloat1(SMALL_NUMBER));
+		const VectorRegister Normalized = VectorMultiply(Vector, VectorReciprocalSqrtAccurate(SizeSquared));
+		return VectorSelect(NonZeroMask, Normalized, VectorZero());
+	}
+
+	/**
+	 * Builds an orthonormal basis with the given Z axis and the X axis as close as possible to the given one.
+	 * Same axes as FRotationMatrix::MakeFromZX, without building the matrix.
+	 */
+	static void MakeBasisFromZX(const FVector& ZAxis, const FVector& XAxis, FVector& OutX, FVector& OutY, FVector& OutZ);
+
+	/** Same as FRotationMatrix::MakeFromZX(ZAxis, XAxis).ToQuat(). */
+	static FQuat MakeQuatFromZX(const FVector& ZAxis, const FVector& XAxis);
+
+	/** Shortest path spherical interpolation between two quaternions. The result is normalized. */
+	static FQuat Slerp(const FQuat& A, const FQuat& B, float Alpha);
+
+
+	/** Splits each vector in its vertical and horizontal components related to the normalized direction with the same index. */
+	static void DecomposeBatch(const FVector* Vectors, const FVector* Directions, int32 Num, FVector* OutVertical, FVector* OutHorizontal);
+
+	/** Splits each vector in its vertical and horizontal components related to a single normalized direction. */
+	static void DecomposeBatch(const FVector* Vectors, const FVector& Direction, int32 Num, FVector* OutVertical, FVector* OutHorizontal);
+};
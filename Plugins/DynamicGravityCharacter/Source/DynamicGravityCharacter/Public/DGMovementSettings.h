@@ -0,0 +1,60 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "DGCharacterMovementComponent.h"
+#include "DGMovementSettings.generated.h"
+
+
+/**
+ * Dynamic gravity tunables shared by many UDGCharacterMovementComponent instances.
+ * A component that references this asset reads its values through it, except for the fields the component overrides, so one edit retunes all of them.
+ * @see UDGCharacterMovementComponent::MovementSettings
+ */
+UCLASS(BlueprintType)
+class DYNAMICGRAVITYCHARACTER_API UDGMovementSettings : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGMovementSettings();
+
+	/** @see UDGCharacterMovementComponent::WalkableFloorNormalMode */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadOnly)
+		EWalkableFloorNormalMode WalkableFloorNormalMode;
+
+	/** @see UDGCharacterMovementComponent::CustomWalkableFloorNormal */
+	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadOnly)
+		FVector CustomWalkableFloorNormal;
+
+	/** @see UDGCharacterMovementComponent::JumpDirectionMode */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadOnly)
+		EJumpDirectionMode JumpDirectionMode;
+
+	/** @see UDGCharacterMovementComponent::CustomJumpDirection */
+	UPROPERTY(Category = "Character Movement: Jumping / Falling", EditAnywhere, BlueprintReadOnly)
+		FVector CustomJumpDirection;
+
+	/** @see UDGCharacterMovementComponent::RotationAdjustIntensity */
+	UPROPERTY(Category = "Character Movement (Rotation Settings)", EditAnywhere, BlueprintReadOnly)
+		float RotationAdjustIntensity;
+
+	/** @see UDGCharacterMovementComponent::PhysicsRotationVerticalDirectionMode */
+	UPROPERTY(Category = "Character Movement (Rotation Settings)", EditAnywhere, BlueprintReadOnly)
+		EPhysicsRotationVerticalDirectionMode PhysicsRotationVerticalDirectionMode;
+
+	/** The RotationRate used as vertical direction when PhysicsRotationVerticalDirectionMode is Custom. @see UDGCharacterMovementComponent::PhysicsRotationVerticalDirectionMode */
+	UPROPERTY(Category = "Character Movement (Rotation Settings)", EditAnywhere, BlueprintReadOnly)
+		FRotator CustomPhysicsRotationVerticalDirection;
+
+	/** @see UDGCharacterMovementComponent::bIgnoreWorldGravityIfDynamicGravityIsNotZero */
+	UPROPERTY(Category = "Character Movement (General Settings)", EditAnywhere, BlueprintReadOnly)
+		bool bIgnoreWorldGravityIfDynamicGravityIsNotZero;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+};
@@ -0,0 +1,89 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "DGProjectileMovementComponent.generated.h"
+
+class UDGGravitySubsystem;
+
+
+/**
+ * Projectile movement under the gravity rules of UDGCharacterMovementComponent::Gravity(), with the dynamic gravity sampled from the gravity fields.
+ * The gravity of all the projectiles is sampled by UDGGravitySubsystem in one pass per frame, at the start and at the predicted end of the frame, and interpolated along the move.
+ * With adaptive substepping, the substeps shrink while the trajectory or the gravity direction turns quickly.
+ */
+UCLASS(ClassGroup = Movement, meta = (BlueprintSpawnableComponent))
+class DYNAMICGRAVITYCHARACTER_API UDGProjectileMovementComponent : public UProjectileMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGProjectileMovementComponent();
+
+	/** Dynamic gravity added to the sampled gravity fields. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		FVector DynamicGravity;
+
+	/** If true, the gravity fields of the world are added to DynamicGravity. */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		bool bSampleGravityFields;
+
+	/** Despises World Gravity if Dynamic Gravity Is Differernt of zero. @see UDGCharacterMovementComponent::bIgnoreWorldGravityIfDynamicGravityIsNotZero */
+	UPROPERTY(Category = "Dynamic Gravity", EditAnywhere, BlueprintReadWrite)
+		bool bIgnoreWorldGravityIfDynamicGravityIsNotZero;
+
+	/** If true, the substep of each tick is computed from how fast the trajectory and the gravity direction turn. bForceSubStepping, MaxSimulationTimeStep and MaxSimulationIterations keep their values. */
+	UPROPERTY(Category = "Projectile Simulation", EditAnywhere, BlueprintReadWrite)
+		bool bAdaptiveSubstepping;
+
+	/** Maximum angle, in degrees, that the velocity or the gravity direction may turn in one substep. */
+	UPROPERTY(Category = "Projectile Simulation", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.1", UIMin = "0.1", EditCondition = "bAdaptiveSubstepping"))
+		float MaxTurnAnglePerSubstep;
+
+	/** Shortest substep of the adaptive substepping. */
+	UPROPERTY(Category = "Projectile Simulation", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0166", ClampMax = "0.50", UIMin = "0.0166", UIMax = "0.50", EditCondition = "bAdaptiveSubstepping"))
+		float MinAdaptiveTimeStep;
+
+	/** Longest substep of the adaptive substepping. */
+	UPROPERTY(Category = "Projectile Simulation", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0166", ClampMax = "0.50", UIMin = "0.0166", UIMax = "0.50", EditCondition = "bAdaptiveSubstepping"))
+		float MaxAdaptiveTimeStep;
+
+
+	/** The dynamic gravity at the current location: DynamicGravity plus the gravity fields sampled this frame. */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector GetDynamicGravity() const;
+
+	/** The gravity at the current location, scaled by ProjectileGravityScale. @see UDGCharacterMovementComponent::Gravity */
+	UFUNCTION(Category = "Dynamic Gravity", BlueprintPure)
+		FVector Gravity() const;
+
+	/** Called by UDGGravitySubsystem with the gravity fields sampled at the start and at the predicted end of the frame. */
+	void SetFrameGravity(const FVector& StartLocation, const FVector& StartGravity, const FVector& EndLocation, const FVector& EndGravity);
+
+	virtual FVector ComputeAcceleration(const FVector& InVelocity, float DeltaTime) const override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void BeginPlay() override;
+
+
+protected:
+
+	/** Sets MaxSimulationTimeStep from the turn rate of the velocity and of the gravity direction. The caller restores the substepping settings after the tick. */
+	void UpdateAdaptiveTimeStep(float DeltaTime);
+
+	/** Samples the gravity fields at the current location, for a projectile that missed the batch of this frame. */
+	void SampleFrameGravity();
+
+	UPROPERTY(Transient)
+		UDGGravitySubsystem* GravitySubsystem;
+
+	/** Gravity fields of this frame, and where they were sampled. */
+	FVector FrameGravityStartLocation;
+	FVector FrameGravityStart;
+	FVector FrameGravityEndLocation;
+	FVector FrameGravityEnd;
+};
@@ -0,0 +1,61 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/RootMotionSource.h"
+#include "DGRootMotionSource.generated.h"
+
+
+/**
+ * A jump force in the gravity frame of the character. The jump goes Distance along Rotation and rises Height along UpVector, instead of the world Z.
+ * Ends when landing after MinimumLandedTriggerTime, or when MinimumLandedTriggerTime is reached if it landed before. @see UDGCharacterMovementComponent::ApplyGravityJumpForce
+ */
+USTRUCT()
+struct DYNAMICGRAVITYCHARACTER_API FDGRootMotionSource_GravityJumpForce : public FRootMotionSource_JumpForce
+{
+	GENERATED_USTRUCT_BODY()
+
+	FDGRootMotionSource_GravityJumpForce();
+
+	virtual ~FDGRootMotionSource_GravityJumpForce() {}
+
+	/** The up direction of the jump, usually the vertical direction of the character when it jumped. */
+	UPROPERTY()
+		FVector UpVector;
+
+	/** If bDisableTimeout is true, the jump ends on the ground only after this time. */
+	UPROPERTY()
+		float MinimumLandedTriggerTime;
+
+	/**
+	 * The location, relative to the start of the jump, at a fraction of the move.
+	 * @param MoveFraction	Fraction of the move, from 0 to 1.
+	 * @return The relative location in world space.
+	 */
+	FVector GetGravityRelativeLocation(float MoveFraction) const;
+
+	virtual FRootMotionSource* Clone() const override;
+
+	virtual bool Matches(const FRootMotionSource* Other) const override;
+
+	virtual bool MatchesAndHasSameState(const FRootMotionSource* Other) const override;
+
+	virtual void PrepareRootMotion(float SimulationTime, float MovementTickTime, const ACharacter& Character, const UCharacterMovementComponent& MoveComponent) override;
+
+	virtual bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess) override;
+
+	virtual UScriptStruct* GetScriptStruct() const override;
+
+	virtual FString ToSimpleString() const override;
+};
+
+template<>
+struct TStructOpsTypeTraits< FDGRootMotionSource_GravityJumpForce > : public TStructOpsTypeTraitsBase2< FDGRootMotionSource_GravityJumpForce >
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithCopy = true
+	};
+};
@@ -0,0 +1,73 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetUserData.h"
+#include "DGSmoothNormalsUserData.generated.h"
+
+class UStaticMesh;
+
+
+/**
+ * Smoothed vertex normals of the complex collision of a static mesh, indexed by collision face.
+ * Add it to the Asset User Data of a static mesh used as a curved walkable surface. The table is built when the mesh is saved or cooked,
+ * and GetSmoothNormal() interpolates it at a hit with the face index and the barycentric coordinates of the impact point, without any trace.
+ * Only hits against complex collision (Use Complex Collision As Simple) have a face index.
+ * @see UDGCharacterMovementComponent::bSmoothFloorImpactNormal
+ */
+UCLASS(ClassGroup = (DynamicGravity), meta = (DisplayName = "DG Smooth Normals"))
+class DYNAMICGRAVITYCHARACTER_API UDGSmoothNormalsUserData : public UAssetUserData
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGSmoothNormalsUserData();
+
+	/** Faces that meet at an angle greater than this, in degrees, keep a hard edge. */
+	UPROPERTY(Category = "Smooth Normals", EditAnywhere, meta = (ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180"))
+		float CreaseAngle;
+
+
+	/**
+	 * The smoothed normal of the surface at a hit.
+	 * @param Hit		A hit with a face index, against a static mesh component whose mesh has this user data.
+	 * @param OutNormal	The smoothed normal, in world space.
+	 * @return False if the hit has no smoothed normal.
+	 */
+	static bool GetSmoothNormal(const FHitResult& Hit, FVector& OutNormal);
+
+	/**
+	 * The smoothed normal of a collision face, in the space of the mesh.
+	 * @param FaceIndex		The collision face.
+	 * @param LocalPoint	A point on the face, in the space of the mesh.
+	 * @return The interpolated normal, or zero if the face is not in the table.
+	 */
+	FVector GetLocalSmoothNormal(int32 FaceIndex, const FVector& LocalPoint) const;
+
+	int32 GetNumFaces() const { return Indices.Num() / 3; }
+
+#if WITH_EDITOR
+	/** Rebuilds the table from the complex collision of a mesh. */
+	void Build(UStaticMesh* Mesh);
+
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+
+protected:
+
+	/** Welded vertices of the collision faces. */
+	UPROPERTY()
+		TArray<FVector> Vertices;
+
+	/** Three vertices per collision face, in the order of the face indices of the hits. */
+	UPROPERTY()
+		TArray<int32> Indices;
+
+	/** Smoothed normal of each corner of each face. */
+	UPROPERTY()
+		TArray<FVector> CornerNormals;
+};
@@ -0,0 +1,70 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "DGSpringArmComponent.generated.h"
+
+class ADGCharacter;
+
+
+/**
+ * Spring arm that follows the view of an ADGCharacter with quaternions, in the frame of its view rotation base instead of the world Z up.
+ *    - The view rotation comes from ADGCharacter::GetViewQuat, and the inherit flags and TargetOffset are relative to the view rotation base.
+ *    - The camera lags in the rotated frame, so a turning gravity doesn't drag the camera around the character.
+ *    - The collision probe is swept at most once per frame, and reused while the rig is stationary.
+ * The arm doesn't tick in server builds.
+ */
+UCLASS(ClassGroup = Camera, meta = (BlueprintSpawnableComponent))
+class DYNAMICGRAVITYCHARACTER_API UDGSpringArmComponent : public USpringArmComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGSpringArmComponent();
+
+	/** The collision probe is reused while the arm origin and the desired camera location move less than this. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", editcondition = "bDoCollisionTest"))
+		float ProbeStationaryTolerance;
+
+	/** Maximum time that a stationary rig reuses its collision probe, to notice geometry that moves into the arm. */
+	UPROPERTY(Category = "Camera Collision", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", editcondition = "bDoCollisionTest"))
+		float ProbeMaxAge;
+
+	/** The rotation of the camera, before the lag. */
+	FQuat GetTargetQuat() const;
+
+	/** The frame of the arm: the view rotation base of the character, or identity. */
+	FQuat GetFrameQuat() const;
+
+	virtual FRotator GetTargetRotation() const override;
+	virtual void OnRegister() override;
+
+
+protected:
+
+	virtual void UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime) override;
+
+	/** Fraction of the lag closed in DeltaTime, with the substeps of bUseCameraLagSubstepping. */
+	float GetLagAlpha(float DeltaTime, float LagSpeed) const;
+
+	/** The owner, found once on register. */
+	TWeakObjectPtr<ADGCharacter> DGCharacter;
+
+	/** Camera rotation of the last update. */
+	FQuat PreviousDesiredQuat;
+
+	/** Offset of the lagged arm origin from the arm origin, in the frame of the arm. */
+	FVector PreviousLagOffset;
+
+	/** The last collision probe. */
+	FVector ProbeStart;
+	FVector ProbeEnd;
+	float ProbeTime;
+	float ProbeHitTime;
+	uint64 ProbeFrame;
+	bool bProbeBlockingHit;
+	bool bProbeValid;
+};
@@ -0,0 +1,263 @@
+﻿// Copyright 2019, Caio Felipe de Moura Peixoto, All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "DGSurfaceNavigationGraph.generated.h"
+
+
+/** A sampled point of walkable collision. */
+USTRUCT()
+struct DYNAMICGRAVITYCHARACTER_API FDGSurfaceNavNode
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Location of the node, NodeHeight above the surface. */
+	UPROPERTY(VisibleAnywhere, Category = "Surface Navigation")
+		FVector Location;
+
+	/** Normal of the surface. The local gravity of the node is the opposite of it. */
+	UPROPERTY(VisibleAnywhere, Category = "Surface Navigation")
+		FVector Up;
+
+	/** Index of the cluster of the node. */
+	UPROPERTY()
+		int32 Cluster;
+
+	/** Range of the edges of the node in UDGSurfaceNavigationGraph::Edges. */
+	UPROPERTY()
+		int32 FirstEdge;
+
+	UPROPERTY()
+		int32 NumEdges;
+
+	FDGSurfaceNavNode()
+		: Location(ForceInitToZero)
+		, Up(FVector::UpVector)
+		, Cluster(INDEX_NONE)
+		, FirstEdge(0)
+		, NumEdges(0)
+	{
+	}
+};
+
+
+/** A walkable connection between two nodes. */
+USTRUCT()
+struct DYNAMICGRAVITYCHARACTER_API FDGSurfaceNavEdge
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		int32 Target;
+
+	UPROPERTY()
+		float Cost;
+
+	FDGSurfaceNavEdge()
+		: Target(INDEX_NONE)
+		, Cost(0.f)
+	{
+	}
+
+	FDGSurfaceNavEdge(int32 InTarget, float InCost)
+		: Target(InTarget)
+		, Cost(InCost)
+	{
+	}
+};
+
+
+/** Connected nodes of the same region. The first level of the hierarchical search. */
+USTRUCT()
+struct DYNAMICGRAVITYCHARACTER_API FDGSurfaceNavCluster
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Average location of the nodes of the cluster. */
+	UPROPERTY()
+		FVector Center;
+
+	/** Range of the neighbor clusters in UDGSurfaceNavigationGraph::ClusterLinks. */
+	UPROPERTY()
+		int32 FirstLink;
+
+	UPROPERTY()
+		int32 NumLinks;
+
+	FDGSurfaceNavCluster()
+		: Center(ForceInitToZero)
+		, FirstLink(0)
+		, NumLinks(0)
+	{
+	}
+};
+
+
+/** Path found in a surface navigation graph. */
+USTRUCT(BlueprintType)
+struct DYNAMICGRAVITYCHARACTER_API FDGSurfacePath
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The points of the path, from start to end. */
+	UPROPERTY(Category = "Surface Navigation", BlueprintReadOnly)
+		TArray<FVector> Points;
+
+	/** The up direction of the surface at each point. */
+	UPROPERTY(Category = "Surface Navigation", BlueprintReadOnly)
+		TArray<FVector> Ups;
+
+	bool IsValid() const { return Points.Num() > 0; }
+
+	void Reset()
+	{
+		Points.Reset();
+		Ups.Reset();
+	}
+};
+
+
+/**
+ * Navigation graph over walkable collision in any orientation, for the surfaces the Z-up navmesh can't represent (walls, ceilings, loops and planets).
+ * It is built offline by BuildGraph, which line traces the world along the six axis directions. Every surface is walkable relative to its own normal.
+ * Paths are found by a hierarchical A*: first over the clusters, then over the nodes of the cluster corridor. Recent paths are cached.
+ * @see UDGCharacterMovementComponent::MoveAlongSurface
+ */
+UCLASS(BlueprintType)
+class DYNAMICGRAVITYCHARACTER_API UDGSurfaceNavigationGraph : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UDGSurfaceNavigationGraph();
+
+
+	/** World space box sampled by BuildGraph. */
+	UPROPERTY(Category = "Build", EditAnywhere)
+		FBox Bounds;
+
+	/** Distance between the sampling traces, and the minimum distance between nodes. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "1", UIMin = "1"))
+		float SampleSpacing;
+
+	/** Height of the nodes above the surface. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float NodeHeight;
+
+	/** Maximum length of an edge. Should be greater than SampleSpacing. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "1", UIMin = "1"))
+		float MaxEdgeLength;
+
+	/** Maximum angle, in degrees, between the normals of two connected nodes. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "0", ClampMax = "180", UIMin = "0", UIMax = "180"))
+		float MaxEdgeAngle;
+
+	/** Maximum number of surfaces found by each sampling trace. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "1", UIMin = "1"))
+		int32 MaxLayers;
+
+	/** Channel of the sampling and edge traces. */
+	UPROPERTY(Category = "Build", EditAnywhere)
+		TEnumAsByte<ECollisionChannel> TraceChannel;
+
+	/** Size of the cells that split the nodes in clusters. */
+	UPROPERTY(Category = "Build", EditAnywhere, meta = (ClampMin = "1", UIMin = "1"))
+		float ClusterSize;
+
+	/** Maximum distance between a query location and its nearest node. */
+	UPROPERTY(Category = "Query", EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float MaxNodeQueryDistance;
+
+	/** Number of recent paths kept by the path cache. */
+	UPROPERTY(Category = "Query", EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		int32 PathCacheSize;
+
+
+	/**
+	 * Samples the walkable collision inside Bounds and rebuilds the graph. Slow, meant to be called from the editor.
+	 * @param WorldContextObject	Object of the world to sample.
+	 */
+	UFUNCTION(Category = "Surface Navigation", BlueprintCallable, meta = (WorldContext = "WorldContextObject"))
+		void BuildGraph(UObject* WorldContextObject);
+
+	/**
+	 * Finds a path between the nodes nearest to Start and End.
+	 * @param Start		The start location.
+	 * @param End		The goal location.
+	 * @param OutPath	The path found.
+	 * @param StartUp	The up direction at Start, usually the vertical direction of the character. If not zero, nodes facing away from it are not taken as the start.
+	 * @param EndUp		The up direction at End. If not zero, nodes facing away from it are not taken as the goal.
+	 * @return True if a path was found.
+	 */
+	UFUNCTION(Category = "Surface Navigation", BlueprintCallable)
+		bool FindPath(const FVector& Start, const FVector& End, FDGSurfacePath& OutPath, const FVector& StartUp = FVector::ZeroVector, const FVector& EndUp = FVector::ZeroVector);
+
+	/**
+	 * Nearest node within MaxNodeQueryDistance.
+	 * @param Location	The query location.
+	 * @param Up		If not zero, nodes facing away from it are ignored.
+	 * @return The index of the node, or INDEX_NONE.
+	 */
+	int32 FindNearestNode(const FVector& Location, const FVector& Up = FVector::ZeroVector) const;
+
+	const TArray<FDGSurfaceNavNode>& GetNodes() const { return Nodes; }
+
+	/** Clears the path cache. */
+	void FlushPathCache() { PathCache.Reset(); }
+
+	virtual void PostLoad() override;
+
+
+protected:
+
+	UPROPERTY(Category = "Graph", VisibleAnywhere)
+		TArray<FDGSurfaceNavNode> Nodes;
+
+	UPROPERTY()
+		TArray<FDGSurfaceNavEdge> Edges;
+
+	UPROPERTY(Category = "Graph", VisibleAnywhere)
+		TArray<FDGSurfaceNavCluster> Clusters;
+
+	UPROPERTY()
+		TArray<int32> ClusterLinks;
+
+
+private:
+
+	/** Rebuilds NodeGrid from Nodes. */
+	void BuildNodeGrid();
+
+	/** Cell of NodeGrid that contains Location. */
+	FIntVector GetNodeCell(const FVector& Location) const;
+
+	/**
+	 * A* over the clusters.
+	 * @param OutCorridor	The clusters of the path and their neighbors.
+	 * @return True if the clusters are connected.
+	 */
+	bool FindClusterCorridor(int32 StartCluster, int32 EndCluster, TSet<int32>& OutCorridor) const;
+
+	/**
+	 * A* over the nodes.
+	 * @param Corridor	If not null, only the nodes of these clusters are expanded.
+	 * @return True if a path was found.
+	 */
+	bool FindNodePath(int32 StartNode, int32 EndNode, const TSet<int32>* Corridor, TArray<int32>& OutNodes) const;
+
+	/** Node indices by cell of MaxEdgeLength size. Rebuilt on load. */
+	TMultiMap<FIntVector, int32> NodeGrid;
+
+	struct FCachedPath
+	{
+		int32 StartNode;
+		int32 EndNode;
+		TArray<int32> Nodes;
+	};
+
+	/** Recent paths, the most recently used last. */
+	TArray<FCachedPath> PathCache;
+};
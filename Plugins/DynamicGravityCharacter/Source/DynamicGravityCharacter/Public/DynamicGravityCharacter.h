@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogDynamicGravity, Log, All);
+DECLARE_STATS_GROUP(TEXT("DynamicGravity"), STATGROUP_DynamicGravity, STATCAT_Advanced);
 
 class FDynamicGravityCharacterModule : public IModuleInterface
 {